@@ -0,0 +1,279 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "GameState.hpp"
+#include "Schema.hpp"
+#include "mapped_file.hpp"
+
+// positions stored column by column so a column can be read as one array straight out of the mapped file
+//
+// the file is the header, then every column starting on a column_alignment boundary
+// a position is one row of the Data table, both players at one move index
+// positions are sorted by game then move index, game_offsets[g] is the first position of game g
+// and game_offsets[game_count] is position_count, so game g is [game_offsets[g], game_offsets[g + 1])
+// everything is little endian
+
+// the per player columns, a column id is columnar_column::p1 + player * field_count + field
+enum class player_field : uint32_t {
+    board,            // packed_board
+    current_piece,    // u8 PieceType
+    move,             // packed_move
+    meter,            // u8
+    attack,           // u8
+    damage_received,  // u8
+    spun,             // u8
+    queue,            // uint16_t, pack_queue
+    hold,             // u8 PieceType, 7 is none
+    count,
+};
+
+enum class columnar_column : uint32_t {
+    game_offsets,  // uint64_t, game_count + 1 of them
+    game_ids,      // int64_t, the game_id from the Data table
+    state,         // u8 VersusGame::State
+    p1,
+    count = p1 + 2 * uint32_t(player_field::count),
+};
+
+constexpr uint32_t column_id(int player, player_field field) {
+    return uint32_t(columnar_column::p1) + uint32_t(player) * uint32_t(player_field::count) + uint32_t(field);
+}
+
+struct columnar_header {
+    static constexpr std::array<char, 8> expected_magic = { 'U', 'T', 'S', 'C', 'O', 'L', 'S', '\0' };
+    // 2 has 40 byte boards with all 32 rows
+    static constexpr uint32_t current_version = 2;
+
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t column_count;
+    uint64_t position_count;
+    uint64_t game_count;
+    // byte offsets from the start of the file
+    std::array<uint64_t, size_t(columnar_column::count)> column_offsets;
+};
+
+constexpr size_t column_alignment = 64;
+
+inline size_t column_element_size(uint32_t column) {
+    switch (columnar_column(column)) {
+        case columnar_column::game_offsets:
+        case columnar_column::game_ids:
+            return sizeof(uint64_t);
+        case columnar_column::state:
+            return sizeof(u8);
+        default:
+            break;
+    }
+    switch (player_field((column - uint32_t(columnar_column::p1)) % uint32_t(player_field::count))) {
+        case player_field::board:
+            return sizeof(packed_board);
+        case player_field::move:
+            return sizeof(packed_move);
+        case player_field::queue:
+            return sizeof(uint16_t);
+        default:
+            return sizeof(u8);
+    }
+}
+
+inline size_t column_element_count(uint32_t column, uint64_t position_count, uint64_t game_count) {
+    switch (columnar_column(column)) {
+        case columnar_column::game_offsets:
+            return game_count + 1;
+        case columnar_column::game_ids:
+            return game_count;
+        default:
+            return position_count;
+    }
+}
+
+// lays the columns out after the header, returns the size of the whole file
+inline size_t layout_columns(columnar_header& header) {
+    size_t offset = sizeof(columnar_header);
+    for (uint32_t column = 0; column < uint32_t(columnar_column::count); column++) {
+        offset = (offset + column_alignment - 1) / column_alignment * column_alignment;
+        header.column_offsets[column] = offset;
+        offset += column_element_size(column) * column_element_count(column, header.position_count, header.game_count);
+    }
+    return offset;
+}
+
+// fills a file of a known number of positions and games, positions have to be added in order
+class columnar_writer {
+public:
+    columnar_writer(const std::filesystem::path& path, uint64_t position_count, uint64_t game_count) {
+        columnar_header header{};
+        header.magic = columnar_header::expected_magic;
+        header.version = columnar_header::current_version;
+        header.column_count = uint32_t(columnar_column::count);
+        header.position_count = position_count;
+        header.game_count = game_count;
+        const size_t size = layout_columns(header);
+
+        file = mapped_file::create(path, size);
+        std::memcpy(file.data(), &header, sizeof(header));
+        this->header = header;
+    }
+
+    // a new game starts with the next position
+    void begin_game(int64_t game_id) {
+        if (games == header.game_count)
+            throw std::runtime_error("more games than the columnar file was made for");
+        column<uint64_t>(uint32_t(columnar_column::game_offsets))[games] = positions;
+        column<int64_t>(uint32_t(columnar_column::game_ids))[games] = game_id;
+        games++;
+    }
+
+    void add(u8 state, const game_state_datum_v2& p1, const game_state_datum_v2& p2) {
+        if (positions == header.position_count || games == 0)
+            throw std::runtime_error("position outside of the games the columnar file was made for");
+
+        column<u8>(uint32_t(columnar_column::state))[positions] = state;
+        const game_state_datum_v2* players[2] = { &p1, &p2 };
+        for (int player = 0; player < 2; player++) {
+            const game_state_datum_v2& p = *players[player];
+            column<packed_board>(column_id(player, player_field::board))[positions] = p.board;
+            column<u8>(column_id(player, player_field::current_piece))[positions] = p.p_type;
+            column<packed_move>(column_id(player, player_field::move))[positions] = packed_move::pack(p.m_type, p.m_rot, p.m_x, p.m_y);
+            column<u8>(column_id(player, player_field::meter))[positions] = p.meter;
+            column<u8>(column_id(player, player_field::attack))[positions] = p.attack;
+            column<u8>(column_id(player, player_field::damage_received))[positions] = p.damage_received;
+            column<u8>(column_id(player, player_field::spun))[positions] = p.spun;
+            column<uint16_t>(column_id(player, player_field::queue))[positions] = uint16_t(pack_queue(p.queue));
+            column<u8>(column_id(player, player_field::hold))[positions] = p.hold;
+        }
+        positions++;
+    }
+
+    // closes the game index and writes everything out, the counts have to match what the file was made for
+    void finish() {
+        if (positions != header.position_count || games != header.game_count)
+            throw std::runtime_error("the columnar file got " + std::to_string(positions) + " positions in " + std::to_string(games) + " games, expected " +
+                                     std::to_string(header.position_count) + " in " + std::to_string(header.game_count));
+        column<uint64_t>(uint32_t(columnar_column::game_offsets))[games] = positions;
+        file.flush();
+    }
+
+private:
+    template <typename T>
+    T* column(uint32_t id) {
+        return (T*)(file.data() + header.column_offsets[id]);
+    }
+
+    mapped_file file;
+    columnar_header header;
+    uint64_t positions = 0;
+    uint64_t games = 0;
+};
+
+// zero copy random access into a columnar file, the spans point into the mapping and live as long as the reader
+class columnar_reader {
+public:
+    explicit columnar_reader(const std::filesystem::path& path) : file(mapped_file::open(path)) {
+        if (file.size() < sizeof(columnar_header))
+            throw std::runtime_error(path.string() + " is too small for a columnar dataset");
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        if (header.magic != columnar_header::expected_magic)
+            throw std::runtime_error(path.string() + " is not a columnar dataset");
+        if (header.version != columnar_header::current_version || header.column_count != uint32_t(columnar_column::count))
+            throw std::runtime_error(path.string() + " has columnar version " + std::to_string(header.version) + ", this build reads " +
+                                     std::to_string(columnar_header::current_version));
+
+        for (uint32_t column = 0; column < header.column_count; column++) {
+            const uint64_t end = header.column_offsets[column] + column_element_size(column) * column_element_count(column, header.position_count, header.game_count);
+            if (header.column_offsets[column] % column_alignment != 0 || end > file.size())
+                throw std::runtime_error(path.string() + " is truncated or corrupt");
+        }
+    }
+
+    size_t position_count() const {
+        return header.position_count;
+    }
+
+    size_t game_count() const {
+        return header.game_count;
+    }
+
+    // the positions of game g
+    size_t game_begin(size_t game) const {
+        return game_offsets()[game];
+    }
+
+    size_t game_end(size_t game) const {
+        return game_offsets()[game + 1];
+    }
+
+    int64_t game_id(size_t game) const {
+        return column<int64_t>(uint32_t(columnar_column::game_ids))[game];
+    }
+
+    // the game position i is in, a binary search over the game index
+    size_t game_of(size_t position) const {
+        const auto offsets = game_offsets();
+        return size_t(std::upper_bound(offsets.begin(), offsets.end() - 1, uint64_t(position)) - offsets.begin()) - 1;
+    }
+
+    std::span<const uint64_t> game_offsets() const {
+        return column<uint64_t>(uint32_t(columnar_column::game_offsets));
+    }
+
+    std::span<const u8> states() const {
+        return column<u8>(uint32_t(columnar_column::state));
+    }
+
+    std::span<const packed_board> boards(int player) const {
+        return column<packed_board>(column_id(player, player_field::board));
+    }
+
+    std::span<const packed_move> moves(int player) const {
+        return column<packed_move>(column_id(player, player_field::move));
+    }
+
+    std::span<const uint16_t> queues(int player) const {
+        return column<uint16_t>(column_id(player, player_field::queue));
+    }
+
+    // current_piece, meter, attack, damage_received, spun and hold
+    std::span<const u8> byte_column(int player, player_field field) const {
+        if (column_element_size(column_id(player, field)) != sizeof(u8))
+            throw std::runtime_error("not a byte column");
+        return column<u8>(column_id(player, field));
+    }
+
+    // the datum of one player at position i, gathered from every column
+    game_state_datum_v2 datum(size_t position, int player) const {
+        game_state_datum_v2 d{};
+        d.board = boards(player)[position];
+        d.p_type = byte_column(player, player_field::current_piece)[position];
+        const packed_move move = moves(player)[position];
+        d.m_type = move.type();
+        d.m_rot = move.rot();
+        d.m_x = move.x();
+        d.m_y = move.y();
+        d.meter = byte_column(player, player_field::meter)[position];
+        d.attack = byte_column(player, player_field::attack)[position];
+        d.damage_received = byte_column(player, player_field::damage_received)[position];
+        d.spun = byte_column(player, player_field::spun)[position];
+        unpack_queue(queues(player)[position], d.queue);
+        d.hold = byte_column(player, player_field::hold)[position];
+        return d;
+    }
+
+private:
+    template <typename T>
+    std::span<const T> column(uint32_t id) const {
+        return { (const T*)(file.data() + header.column_offsets[id]), column_element_count(id, header.position_count, header.game_count) };
+    }
+
+    mapped_file file;
+    columnar_header header;
+};
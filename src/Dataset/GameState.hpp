@@ -1,4 +1,7 @@
+#pragma once
 #include "../Shaktris/Board.hpp"
+#include "../Shaktris/Piece.hpp"
+#include <array>
 #include <cstdint>
 
 using u8 = uint8_t;
@@ -26,3 +29,136 @@ struct game_state_datum {
     u8 queue[5];
     u8 hold;
 };
+
+// every row of a board, each column as a 32 bit word, column 0 first, little endian
+// 40 bytes instead of the 320 a byte per cell takes, the rows above the visible 20 are kept too
+struct packed_board {
+    static constexpr size_t rows = Board::height;
+    static_assert(rows == 32, "a column is packed as one 32 bit word");
+
+    std::array<u8, Board::width * rows / 8> bytes;
+};
+
+inline packed_board pack_board(const Board& board) {
+    packed_board packed{};
+    for (size_t x = 0; x < Board::width; x++)
+        for (size_t i = 0; i < 4; i++)
+            packed.bytes[x * 4 + i] = u8(board.board[x] >> (i * 8));
+    return packed;
+}
+
+inline Board unpack_board(const packed_board& packed) {
+    Board board;
+    for (size_t x = 0; x < Board::width; x++)
+        for (size_t i = 0; i < 4; i++)
+            board.board[x] |= uint32_t(packed.bytes[x * 4 + i]) << (i * 8);
+    board.rehash();
+    return board;
+}
+
+// the board of a v1 datum, b holds one byte per cell with x + y * 10
+inline Board unpack_board(const std::array<u8, 10 * 20>& cells) {
+    Board board;
+    for (size_t y = 0; y < Board::visual_height; y++)
+        for (size_t x = 0; x < Board::width; x++)
+            board.board[x] |= uint32_t(cells[x + y * Board::width] != 0) << y;
+    board.rehash();
+    return board;
+}
+
+// the board of a v2 row, only the visible 20 rows, 20 bits per column packed back to back, column 0 first, little endian
+inline Board unpack_board(const std::array<u8, Board::width * Board::visual_height / 8>& bytes) {
+    constexpr int rows = Board::visual_height;
+    Board board;
+    uint64_t bits = 0;
+    int bit_count = 0;
+    size_t in = 0;
+    for (size_t x = 0; x < Board::width; x++) {
+        for (; bit_count < rows; bit_count += 8)
+            bits |= uint64_t(bytes[in++]) << bit_count;
+        board.board[x] = uint32_t(bits) & ((1u << rows) - 1);
+        bits >>= rows;
+        bit_count -= rows;
+    }
+    board.rehash();
+    return board;
+}
+
+// same fields as game_state_datum with the board packed, 55 bytes instead of 215
+struct game_state_datum_v2 {
+
+    // board
+    packed_board board;
+
+    // current piece type
+    u8 p_type;
+
+    // move
+    u8 m_type;
+    u8 m_rot;
+    u8 m_x;
+    u8 m_y;
+
+    // extra data
+    u8 meter;
+    u8 attack;
+    u8 damage_received;
+    u8 spun;
+    u8 queue[5];
+    u8 hold;
+};
+
+inline game_state_datum_v2 to_v2(const game_state_datum& datum) {
+    game_state_datum_v2 v2{};
+    v2.board = pack_board(unpack_board(datum.b));
+    v2.p_type = datum.p_type;
+    v2.m_type = datum.m_type;
+    v2.m_rot = datum.m_rot;
+    v2.m_x = datum.m_x;
+    v2.m_y = datum.m_y;
+    v2.meter = datum.meter;
+    v2.attack = datum.attack;
+    v2.damage_received = datum.damage_received;
+    v2.spun = datum.spun;
+    std::copy(std::begin(datum.queue), std::end(datum.queue), v2.queue);
+    v2.hold = datum.hold;
+    return v2;
+}
+
+// a move in 16 bits, from the low bit up: type 3, rotation 2, x 4, y 5, spin 2
+// x is the piece center so it stays in 0..9, y stays under Board::height
+struct packed_move {
+    uint16_t bits;
+
+    static packed_move pack(u8 type, u8 rot, u8 x, u8 y, u8 spin = 0) {
+        return { uint16_t((type & 7) | (rot & 3) << 3 | (x & 15) << 5 | (y & 31) << 9 | (spin & 3) << 14) };
+    }
+
+    static packed_move pack(const Piece& piece) {
+        return pack((u8)piece.type, (u8)piece.rotation, (u8)piece.position.x, (u8)piece.position.y, (u8)piece.spin);
+    }
+
+    u8 type() const {
+        return u8(bits & 7);
+    }
+
+    u8 rot() const {
+        return u8(bits >> 3 & 3);
+    }
+
+    u8 x() const {
+        return u8(bits >> 5 & 15);
+    }
+
+    u8 y() const {
+        return u8(bits >> 9 & 31);
+    }
+
+    u8 spin() const {
+        return u8(bits >> 14 & 3);
+    }
+
+    Piece piece() const {
+        return Piece(PieceType(type()), Coord{ int8_t(x()), int8_t(y()) }, RotationDirection(rot()), spinType(spin()));
+    }
+};
@@ -0,0 +1,209 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GameState.hpp"
+#include "VersusGame.hpp"
+#include "mapped_file.hpp"
+
+// games stored as the two seeds and the moves played, every position is rebuilt by playing the moves again
+// a VersusGame is decided by its seeds and moves, so this is all a game needs, a few bytes a turn
+//
+// the file is a replay_file_header and then the games back to back, each a replay_game_header
+// followed by turns pairs of packed_move, player 1 first
+// games are only ever appended, a game cut short by a crash is left out by the reader
+// everything is little endian
+
+// bumped when the rules in Game or VersusGame change in a way that plays the same moves out differently
+constexpr uint16_t replay_ruleset = 1;
+
+struct replay_file_header {
+    static constexpr std::array<char, 8> expected_magic = { 'U', 'T', 'S', 'R', 'P', 'L', 'Y', '\0' };
+    static constexpr uint32_t current_version = 1;
+
+    std::array<char, 8> magic;
+    uint32_t version;
+    // the rules the games were played with
+    uint16_t ruleset;
+    uint16_t queue_size;
+};
+
+struct replay_game_header {
+    int64_t game_id;
+    uint32_t p1_seed;
+    uint32_t p2_seed;
+    uint32_t turns;
+    // VersusGame::State at the end, a forfeit ends a game in a way the moves dont show
+    u8 result;
+    u8 padding[3];
+};
+
+static_assert(sizeof(replay_file_header) == 16 && sizeof(replay_game_header) == 24, "replay headers are written as they are in memory");
+
+// a game being recorded
+struct replay_game {
+    int64_t game_id = 0;
+    uint32_t p1_seed = 0;
+    uint32_t p2_seed = 0;
+    VersusGame::State result = VersusGame::State::PLAYING;
+    std::vector<std::array<packed_move, 2>> turns;
+};
+
+inline replay_file_header current_replay_header() {
+    return { replay_file_header::expected_magic, replay_file_header::current_version, replay_ruleset, uint16_t(Game::queue_size) };
+}
+
+inline bool is_current_replay(const replay_file_header& header) {
+    const replay_file_header current = current_replay_header();
+    return header.magic == current.magic && header.version == current.version && header.ruleset == current.ruleset &&
+           header.queue_size == current.queue_size;
+}
+
+// maps a replay file and rebuilds any position of any game from it
+class replay_reader {
+public:
+    explicit replay_reader(const std::filesystem::path& path) : file(mapped_file::open(path)) {
+        replay_file_header header{};
+        if (file.size() < sizeof(header))
+            throw std::runtime_error(path.string() + " is too small for a replay file");
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (!is_current_replay(header))
+            throw std::runtime_error(path.string() + " is not a replay file of this version and ruleset");
+
+        // only the game headers are read, the moves are not touched until a game is replayed
+        size_t offset = sizeof(header);
+        while (offset + sizeof(replay_game_header) <= file.size()) {
+            replay_game_header game;
+            std::memcpy(&game, file.data() + offset, sizeof(game));
+            const size_t end = offset + sizeof(game) + size_t(game.turns) * 2 * sizeof(packed_move);
+            if (end > file.size())
+                break;
+            game_offsets.push_back(offset);
+            offset = end;
+        }
+        trailing_bytes = file.size() - offset;
+    }
+
+    // size of the file in bytes
+    size_t size() const {
+        return file.size();
+    }
+
+    size_t game_count() const {
+        return game_offsets.size();
+    }
+
+    // bytes at the end that are not a whole game, left by a writer that stopped half way
+    size_t get_trailing_bytes() const {
+        return trailing_bytes;
+    }
+
+    replay_game_header game_header(size_t game) const {
+        replay_game_header header;
+        std::memcpy(&header, file.data() + game_offsets[game], sizeof(header));
+        return header;
+    }
+
+    // turn t is moves()[2 * t] for player 1 and moves()[2 * t + 1] for player 2
+    std::span<const packed_move> moves(size_t game) const {
+        return { (const packed_move*)(file.data() + game_offsets[game] + sizeof(replay_game_header)), size_t(game_header(game).turns) * 2 };
+    }
+
+    // the game after the first turn turns were played, turns == the game's turns gives the end of the game
+    VersusGame position(size_t game, size_t turns) const {
+        const replay_game_header header = game_header(game);
+        if (turns > header.turns)
+            throw std::runtime_error("game " + std::to_string(header.game_id) + " only has " + std::to_string(header.turns) + " turns");
+
+        const std::span<const packed_move> played = moves(game);
+        VersusGame versus(header.p1_seed, header.p2_seed);
+        for (size_t turn = 0; turn < turns; turn++) {
+            versus.p1_move = Move(played[2 * turn].piece(), false);
+            versus.p2_move = Move(played[2 * turn + 1].piece(), false);
+            versus.play_moves();
+        }
+
+        if (turns == header.turns) {
+            versus.state = VersusGame::State(header.result);
+            versus.game_over = versus.state != VersusGame::State::PLAYING;
+        }
+        return versus;
+    }
+
+    // calls on_position(turn, versus) with the game before every turn and once more at the end
+    // one pass over the game, for when every position is wanted
+    template <typename F>
+    void play(size_t game, F&& on_position) const {
+        const replay_game_header header = game_header(game);
+        const std::span<const packed_move> played = moves(game);
+        VersusGame versus(header.p1_seed, header.p2_seed);
+        for (size_t turn = 0; turn < header.turns; turn++) {
+            on_position(turn, std::as_const(versus));
+            versus.p1_move = Move(played[2 * turn].piece(), false);
+            versus.p2_move = Move(played[2 * turn + 1].piece(), false);
+            versus.play_moves();
+        }
+        versus.state = VersusGame::State(header.result);
+        versus.game_over = versus.state != VersusGame::State::PLAYING;
+        on_position(size_t(header.turns), std::as_const(versus));
+    }
+
+private:
+    mapped_file file;
+    std::vector<size_t> game_offsets;
+    size_t trailing_bytes = 0;
+};
+
+// appends games to a replay file, creating it if it is missing
+class replay_writer {
+public:
+    explicit replay_writer(const std::filesystem::path& path) {
+        const bool exists = std::filesystem::exists(path) && std::filesystem::file_size(path) > 0;
+        if (exists) {
+            // a game cut off by a crash is dropped so the next one starts where the reader expects it
+            size_t whole_games_size;
+            {
+                const replay_reader existing(path);
+                whole_games_size = existing.size() - existing.get_trailing_bytes();
+            }
+            if (whole_games_size < std::filesystem::file_size(path))
+                std::filesystem::resize_file(path, whole_games_size);
+        }
+
+        file.open(path, std::ios::binary | std::ios::app);
+        if (!file)
+            throw std::runtime_error("couldnt open " + path.string());
+
+        if (!exists) {
+            const replay_file_header header = current_replay_header();
+            file.write((const char*)&header, sizeof(header));
+            file.flush();
+        }
+    }
+
+    void write(const replay_game& game) {
+        replay_game_header header{};
+        header.game_id = game.game_id;
+        header.p1_seed = game.p1_seed;
+        header.p2_seed = game.p2_seed;
+        header.turns = uint32_t(game.turns.size());
+        header.result = u8(game.result);
+
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)game.turns.data(), std::streamsize(game.turns.size() * sizeof(game.turns[0])));
+        file.flush();
+        if (!file)
+            throw std::runtime_error("couldnt write the replay");
+    }
+
+private:
+    std::ofstream file;
+};
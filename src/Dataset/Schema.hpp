@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "GameState.hpp"
+
+// layout of the Data table the stadium writes, the version is kept in PRAGMA user_version
+//
+// v1 stores piece types, queue slots, the hold and the game state as TEXT ("S", "NULL", "PLAYING")
+// v2 stores them as small integers with the queue in one integer, and drops the rowid
+// v3 packs all 32 rows of the boards instead of the visible 20, 40 byte blobs instead of 25
+constexpr int data_schema_version = 3;
+
+// piece types are PieceType values and 7 is no piece, state is a VersusGame::State value
+// the boards are packed_board blobs
+inline std::string create_data_table_sql(std::string_view table) {
+    std::string sql = "CREATE TABLE IF NOT EXISTS ";
+    sql += table;
+    sql +=
+        " ("
+        "game_id INTEGER NOT NULL, "
+        "move_index INTEGER NOT NULL, "
+        "state INTEGER NOT NULL, "
+        "p1_board BLOB NOT NULL, p1_current_piece INTEGER NOT NULL, p1_move_piece_type INTEGER NOT NULL, "
+        "p1_move_piece_rot INTEGER NOT NULL, p1_move_piece_x INTEGER NOT NULL, p1_move_piece_y INTEGER NOT NULL, "
+        "p1_meter INTEGER NOT NULL, p1_attack INTEGER NOT NULL, p1_damage_received INTEGER NOT NULL, "
+        "p1_spun INTEGER NOT NULL, p1_queue INTEGER NOT NULL, p1_hold INTEGER NOT NULL, "
+        "p2_board BLOB NOT NULL, p2_current_piece INTEGER NOT NULL, p2_move_piece_type INTEGER NOT NULL, "
+        "p2_move_piece_rot INTEGER NOT NULL, p2_move_piece_x INTEGER NOT NULL, p2_move_piece_y INTEGER NOT NULL, "
+        "p2_meter INTEGER NOT NULL, p2_attack INTEGER NOT NULL, p2_damage_received INTEGER NOT NULL, "
+        "p2_spun INTEGER NOT NULL, p2_queue INTEGER NOT NULL, p2_hold INTEGER NOT NULL, "
+        "PRIMARY KEY(game_id, move_index)"
+        ") WITHOUT ROWID;";
+    return sql;
+}
+
+// binds in the column order of create_data_table_sql, 27 parameters
+inline std::string insert_data_sql(std::string_view table) {
+    std::string sql = "INSERT INTO ";
+    sql += table;
+    sql += " VALUES (?";
+    for (int i = 1; i < 27; i++)
+        sql += ",?";
+    sql += ");";
+    return sql;
+}
+
+// the five queue slots 3 bits each, slot 0 in the lowest bits
+constexpr int queue_slot_bits = 3;
+
+inline int pack_queue(const u8 (&queue)[5]) {
+    int packed = 0;
+    for (int i = 0; i < 5; i++)
+        packed |= (queue[i] & ((1 << queue_slot_bits) - 1)) << (i * queue_slot_bits);
+    return packed;
+}
+
+inline void unpack_queue(int packed, u8 (&queue)[5]) {
+    for (int i = 0; i < 5; i++)
+        queue[i] = u8((packed >> (i * queue_slot_bits)) & ((1 << queue_slot_bits) - 1));
+}
+
+// reads the v1 text of a piece type, "NULL" and anything unknown is no piece
+inline u8 piece_type_from_text(std::string_view text) {
+    constexpr std::string_view names = "SZJLTOI";
+    if (text.size() == 1 && names.find(text[0]) != std::string_view::npos)
+        return u8(names.find(text[0]));
+    return 7;
+}
+
+// reads the v1 text of a game state, unknown text is PLAYING
+inline u8 game_state_from_text(std::string_view text) {
+    constexpr std::array<std::string_view, 4> names = { "PLAYING", "P1_WIN", "P2_WIN", "DRAW" };
+    for (u8 i = 0; i < names.size(); i++)
+        if (names[i] == text)
+            return i;
+    return 0;
+}
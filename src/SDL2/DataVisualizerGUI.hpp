@@ -84,12 +84,7 @@ class DataVisualizerGUI {
         game.state = state;
 
         // set the game 
-        game.p1_game.board = Board{};
-        for(size_t x = 0; x < 10; x++)
-            for(size_t y = 0; y < 20; y++) {
-                if(p1.b[x + y * 10] == 1)
-                    game.p1_game.board.set(x,y);
-            }
+        game.p1_game.board = unpack_board(p1.b);
 
         game.p1_game.current_piece = Piece((PieceType)p1.m_type, Coord(p1.m_x, p1.m_y), (RotationDirection)p1.m_rot, spinType::null);
 
@@ -100,12 +95,7 @@ class DataVisualizerGUI {
         game.p1_game.hold = p1.hold == 7 ? std::nullopt : std::optional(Piece((PieceType)p1.hold));
 
         
-        game.p2_game.board = Board{};
-        for(size_t x = 0; x < 10; x++)
-            for(size_t y = 0; y < 20; y++) {
-                if(p2.b[x + y * 10] == 1)
-                    game.p2_game.board.set(x,y);
-            }
+        game.p2_game.board = unpack_board(p2.b);
 
         game.p2_game.current_piece = Piece((PieceType)p2.m_type, Coord(p2.m_x, p2.m_y), (RotationDirection)p2.m_rot, spinType::null);
 
@@ -216,7 +206,7 @@ class DataVisualizerGUI {
         }
         Color col = get_color(piece.value().type);
         window.setDrawColor(col.r, col.g, col.b, col.a);
-        for (auto& mino : piece.value().minos) {
+        for (auto& mino : piece.value().minos()) {
             Rect cell = {
                 int(ceil(area.x + (2 + mino.x) * cell_size.x)),
                 int(ceil(area.y + (2 - mino.y) * cell_size.y)),
@@ -257,7 +247,7 @@ class DataVisualizerGUI {
         Color col = get_color(piece.type);
         window.setDrawColor(col.r, col.g, col.b, col.a);
 
-        for (auto& mino : piece.minos) {
+        for (auto& mino : piece.minos()) {
             Rect cell = {
                 int(ceil(board_point.x + (piece.position.x + mino.x) * cell_size.x)),
                 int(ceil(board_point.y - (piece.position.y + mino.y) * cell_size.y - cell_size.y)),
@@ -254,7 +254,7 @@ private:
         }
         Color col = get_color(piece.value().type);
         window.setDrawColor(col.r, col.g, col.b, col.a);
-        for (auto& mino : piece.value().minos) {
+        for (auto& mino : piece.value().minos()) {
             Rect cell = {
                 int(ceil(area.x + (2 + mino.x) * cell_size.x)),
                 int(ceil(area.y + (2 - mino.y) * cell_size.y)),
@@ -291,7 +291,7 @@ private:
         Color col = get_color(piece.type);
         window.setDrawColor(col.r, col.g, col.b, col.a);
 
-        for (auto& mino : piece.minos) {
+        for (auto& mino : piece.minos()) {
             Rect cell = {
                 int(ceil(board_point.x + (piece.position.x + mino.x) * cell_size.x)),
                 int(ceil(board_point.y - (piece.position.y + mino.y) * cell_size.y)),
@@ -1,18 +1,54 @@
 #pragma once
+#include <algorithm>
 #include <array>
 #include <bit>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <stdexcept>
 
 #include "Piece.hpp"
 #include "pext.hpp"
 
+// surface statistics of a board, what most hand written evaluations are built from
+struct BoardFeatures {
+    std::array<uint8_t, 10> heights{};
+    int max_height = 0;
+    // sum of the column heights
+    int aggregate_height = 0;
+    // empty cells with a filled cell somewhere above them
+    int holes = 0;
+    // sum of the height differences of neighbouring columns
+    int bumpiness = 0;
+    // sum of the depths of columns lower than both neighbours, the walls count as infinitely high
+    int wells = 0;
+    // filled to empty changes along the rows up to max_height, the walls count as filled
+    int row_transitions = 0;
+    // filled to empty changes up each column below its height, the floor counts as filled
+    int column_transitions = 0;
+};
+
 class Board {
 public:
     static constexpr size_t width = 10;
     static constexpr size_t visual_height = 20;
     static constexpr size_t height = 32;
+
+    // random key per cell, the board hash is the xor of the keys of every filled cell
+    static constexpr std::array<std::array<uint64_t, height>, width> zobrist_keys = [] {
+        std::array<std::array<uint64_t, height>, width> keys{};
+        // splitmix64
+        uint64_t state = 0x5368616b74726973;
+        for (auto& column : keys)
+            for (auto& key : column) {
+                uint64_t z = (state += 0x9e3779b97f4a7c15);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+                key = z ^ (z >> 31);
+            }
+        return keys;
+    }();
+
     Board() {
         board.fill(0);
     }
@@ -32,34 +68,256 @@ public:
         return board[x];
     }
 
+    uint64_t get_hash() const {
+        return hash;
+    }
+
+    // keeps the column heights and the hole count up to date on every change instead of computing them on demand
+    // worth it for boards that are asked for them more often than they change, like the ones an evaluator looks at
+    void set_surface_tracking(bool enabled) {
+        surface_tracking = enabled;
+        if (enabled)
+            refresh_surface();
+    }
+
+    bool tracks_surface() const {
+        return surface_tracking;
+    }
+
+    // the row above the highest filled cell of the column
+    int column_height(size_t x) const {
+        if (surface_tracking)
+            return heights[x];
+        return column_height_of(board[x]);
+    }
+
+    int get_holes() const {
+        if (surface_tracking)
+            return holes;
+        int total = 0;
+        for (const uint32_t& column : board)
+            total += column_holes_of(column);
+        return total;
+    }
+
     void set(size_t x, size_t y) {
+        if (!get(x, y))
+            hash ^= zobrist_keys[x][y];
+        const uint32_t old_column = board[x];
         board[x] |= (1 << y);
+        column_changed(x, old_column);
     }
 
     void unset(size_t x, size_t y) {
+        if (get(x, y))
+            hash ^= zobrist_keys[x][y];
+        const uint32_t old_column = board[x];
         board[x] &= ~(1 << y);
+        column_changed(x, old_column);
     }
 
     void set(const Piece& piece) {
-        for (const Coord& mino : piece.minos) {
-            set(
-                (size_t)mino.x + piece.position.x,
-                (size_t)mino.y + piece.position.y);
+        const PieceMask& mask = piece_masks[static_cast<size_t>(piece.type)][piece.rotation];
+        const int x = piece.position.x + mask.min_x;
+        const int y = piece.position.y + mask.min_y;
+
+        for (int c = 0; c <= mask.max_x - mask.min_x; c++) {
+            uint32_t added = (mask.columns[c] << y) & ~board[x + c];
+            const uint32_t old_column = board[x + c];
+            board[x + c] |= added;
+            column_changed(x + c, old_column);
+            while (added) {
+                hash ^= zobrist_keys[x + c][std::countr_zero(added)];
+                added &= added - 1;
+            }
         }
     }
 
-    int clearLines() {
+    void unset(const Piece& piece) {
+        const PieceMask& mask = piece_masks[static_cast<size_t>(piece.type)][piece.rotation];
+        const int x = piece.position.x + mask.min_x;
+        const int y = piece.position.y + mask.min_y;
+
+        for (int c = 0; c <= mask.max_x - mask.min_x; c++) {
+            uint32_t removed = (mask.columns[c] << y) & board[x + c];
+            const uint32_t old_column = board[x + c];
+            board[x + c] &= ~removed;
+            column_changed(x + c, old_column);
+            while (removed) {
+                hash ^= zobrist_keys[x + c][std::countr_zero(removed)];
+                removed &= removed - 1;
+            }
+        }
+    }
+
+    // true if the piece overlaps a filled cell or sticks out of the board
+    bool collides(const Piece& piece) const {
+        const PieceMask& mask = piece_masks[static_cast<size_t>(piece.type)][piece.rotation];
+        const int x = piece.position.x + mask.min_x;
+        const int y = piece.position.y + mask.min_y;
+
+        if (x < 0 || piece.position.x + mask.max_x >= (int)width)
+            return true;
+        if (y < 0 || piece.position.y + mask.max_y >= (int)height)
+            return true;
+
+        uint32_t overlap = 0;
+        for (int c = 0; c <= mask.max_x - mask.min_x; c++)
+            overlap |= board[x + c] & (mask.columns[c] << y);
+        return overlap != 0;
+    }
+
+    // bit y is set if row y is completely filled
+    uint32_t full_rows() const {
         uint32_t mask = UINT32_MAX;
-        for (uint32_t& column : board)
+        for (const uint32_t& column : board)
             mask &= column;
+        return mask;
+    }
+
+    int clearLines() {
+        uint32_t mask = full_rows();
+        if (!mask)
+            return 0;
         int lines_cleared = std::popcount(mask);
-        mask = ~mask;
 
-        for (uint32_t& column : board)
-            column = pext(column, mask);
+        remove_rows(board.data(), board.size(), mask);
+
+        // every row above a cleared line moved, its cheaper to start over than to patch the hash
+        rehash();
+        refresh_surface();
 
         return lines_cleared;
     }
 
+    // puts back rows that clearLines removed, rows is the mask full_rows gave before clearing
+    void restore_rows(uint32_t rows) {
+        if (!rows)
+            return;
+
+        insert_full_rows(board.data(), board.size(), rows);
+        rehash();
+        refresh_surface();
+    }
+
+    // pushes the board up and fills the bottom lines with garbage, leaving a hole in the given column
+    void add_garbage(int lines, int location) {
+        for (int i = 0; i < width; ++i) {
+            auto& column = board[i];
+
+            column <<= lines;
+
+            if (location != i) {
+                column |= (1 << lines) - 1;
+            }
+        }
+
+        rehash();
+        refresh_surface();
+    }
+
+    BoardFeatures features() const {
+        BoardFeatures out;
+        compute_features(this, &out, 1);
+        return out;
+    }
+
+    // features of many boards at once, every step is a fixed length loop over the columns so it vectorises
+    static void compute_features(const Board* boards, BoardFeatures* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const std::array<uint32_t, width>& columns = boards[i].board;
+            BoardFeatures& features = out[i];
+
+            std::array<int, width> heights;
+            std::array<int, width> counts;
+            for (size_t x = 0; x < width; x++) {
+                heights[x] = column_height_of(columns[x]);
+                counts[x] = std::popcount(columns[x]);
+            }
+
+            int max_height = 0;
+            int aggregate_height = 0;
+            int holes = 0;
+            int column_transitions = 0;
+            for (size_t x = 0; x < width; x++) {
+                max_height = std::max(max_height, heights[x]);
+                aggregate_height += heights[x];
+                holes += heights[x] - counts[x];
+                // a cell differs from the one below it, the floor below row 0 is filled
+                const uint32_t below_height = uint32_t((uint64_t(1) << heights[x]) - 1);
+                column_transitions += std::popcount((columns[x] ^ (columns[x] << 1 | 1)) & below_height);
+                features.heights[x] = uint8_t(heights[x]);
+            }
+
+            int bumpiness = 0;
+            int wells = 0;
+            const uint32_t rows = uint32_t((uint64_t(1) << max_height) - 1);
+            int row_transitions = std::popcount(~columns[0] & rows) + std::popcount(~columns[width - 1] & rows);
+            for (size_t x = 0; x < width; x++) {
+                const int left = x == 0 ? int(height) : heights[x - 1];
+                const int right = x == width - 1 ? int(height) : heights[x + 1];
+                wells += std::max(0, std::min(left, right) - heights[x]);
+                if (x + 1 < width) {
+                    bumpiness += std::abs(heights[x] - heights[x + 1]);
+                    row_transitions += std::popcount((columns[x] ^ columns[x + 1]) & rows);
+                }
+            }
+
+            features.max_height = max_height;
+            features.aggregate_height = aggregate_height;
+            features.holes = holes;
+            features.bumpiness = bumpiness;
+            features.wells = wells;
+            features.row_transitions = row_transitions;
+            features.column_transitions = column_transitions;
+        }
+    }
+
+    // recomputes the hash from the columns, needed after writing to board directly
+    // call refresh_surface too if surface tracking is on
+    void rehash() {
+        hash = 0;
+        for (size_t x = 0; x < width; x++) {
+            uint32_t column = board[x];
+            while (column) {
+                hash ^= zobrist_keys[x][std::countr_zero(column)];
+                column &= column - 1;
+            }
+        }
+    }
+
+    // recomputes the cached heights and holes from the columns, does nothing if surface tracking is off
+    void refresh_surface() {
+        if (!surface_tracking)
+            return;
+        holes = 0;
+        for (size_t x = 0; x < width; x++) {
+            heights[x] = uint8_t(column_height_of(board[x]));
+            holes += column_holes_of(board[x]);
+        }
+    }
+
     std::array<uint32_t, Board::width> board;
+
+private:
+    static int column_height_of(uint32_t column) {
+        return 32 - std::countl_zero(column);
+    }
+
+    static int column_holes_of(uint32_t column) {
+        return column_height_of(column) - std::popcount(column);
+    }
+
+    void column_changed(size_t x, uint32_t old_column) {
+        if (!surface_tracking)
+            return;
+        heights[x] = uint8_t(column_height_of(board[x]));
+        holes += column_holes_of(board[x]) - column_holes_of(old_column);
+    }
+
+    uint64_t hash = 0;
+
+    bool surface_tracking = false;
+    std::array<uint8_t, width> heights{};
+    int holes = 0;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 
@@ -8,7 +9,7 @@ using u16 = uint16_t;  ///<  16-bit unsigned integer.
 using u32 = uint32_t;  ///<  32-bit unsigned integer.
 using u64 = uint64_t;  ///<  64-bit unsigned integer.
 
-enum class spinType {
+enum class spinType : u8 {
     null,
     mini,
     normal,
@@ -112,3 +113,95 @@ constexpr std::array<std::array<Coord, 4>, 8> piece_definitions = {
         {{{0, 0}, {0, 0}, {0, 0}, {0, 0}}}     // NULL
     } 
 };
+
+// a rotation step as done by Piece::rotate, clockwise when turning right
+constexpr Coord rotate_mino(Coord mino, TurnDirection direction) {
+    if (direction == TurnDirection::Left)
+        return { (int8_t)-mino.y, mino.x };
+    return { mino.y, (int8_t)-mino.x };
+}
+
+// minos of every piece type in every rotation, indexed by [type][rotation]
+constexpr std::array<std::array<std::array<Coord, 4>, RotationDirections_N>, 8> piece_minos = [] {
+    std::array<std::array<std::array<Coord, 4>, RotationDirections_N>, 8> minos{};
+
+    for (size_t type = 0; type < piece_definitions.size(); type++) {
+        minos[type][North] = piece_definitions[type];
+        for (size_t rotation = 1; rotation < RotationDirections_N; rotation++)
+            for (size_t i = 0; i < 4; i++)
+                minos[type][rotation][i] = rotate_mino(minos[type][rotation - 1][i], TurnDirection::Right);
+    }
+
+    return minos;
+}();
+
+// how far each srs kick moves the piece when turning out of a rotation, indexed by [type][rotation][direction][kick]
+// this is the difference of the offsets of the rotation before and after the turn
+constexpr std::array<std::array<std::array<std::array<Coord, srs_kicks>, 2>, RotationDirections_N>, 8> piece_kicks = [] {
+    std::array<std::array<std::array<std::array<Coord, srs_kicks>, 2>, RotationDirections_N>, 8> kicks{};
+
+    for (size_t type = 0; type < kicks.size(); type++) {
+        const std::array<std::array<Coord, srs_kicks>, RotationDirections_N>& offsets =
+            type == static_cast<size_t>(PieceType::I) ? piece_offsets_I :
+            type == static_cast<size_t>(PieceType::O) ? piece_offsets_O :
+            piece_offsets_JLSTZ;
+
+        for (size_t rotation = 0; rotation < RotationDirections_N; rotation++) {
+            for (TurnDirection direction : { TurnDirection::Left, TurnDirection::Right }) {
+                const size_t next = (rotation + (direction == TurnDirection::Left ? 3 : 1)) % RotationDirections_N;
+                for (size_t i = 0; i < srs_kicks; i++) {
+                    kicks[type][rotation][direction][i] = {
+                        int8_t(offsets[rotation][i].x - offsets[next][i].x),
+                        int8_t(offsets[rotation][i].y - offsets[next][i].y),
+                    };
+                }
+            }
+        }
+    }
+
+    return kicks;
+}();
+
+// corners around the center of a T, indexed by rotation
+// 0 is below left, 1 above left, 2 below right and 3 above right of the center
+// the two corners on the side the T points at come first
+constexpr std::array<std::array<uint8_t, 4>, RotationDirections_N> t_spin_corners = { {
+    {{1, 3, 2, 0}},  // North
+    {{3, 2, 0, 1}},  // East
+    {{2, 0, 1, 3}},  // South
+    {{0, 1, 3, 2}},  // West
+} };
+
+// occupancy of a piece in one rotation as column masks, relative to its bottom left corner
+struct PieceMask {
+    // bit y of column c is the cell (min_x + c, min_y + y) relative to the piece position
+    std::array<uint32_t, 4> columns;
+    int8_t min_x;
+    int8_t max_x;
+    int8_t min_y;
+    int8_t max_y;
+};
+
+// masks for every piece type in every rotation, indexed by [type][rotation]
+constexpr std::array<std::array<PieceMask, RotationDirections_N>, 8> piece_masks = [] {
+    std::array<std::array<PieceMask, RotationDirections_N>, 8> masks{};
+
+    for (size_t type = 0; type < piece_minos.size(); type++) {
+        for (size_t rotation = 0; rotation < RotationDirections_N; rotation++) {
+            const std::array<Coord, 4>& minos = piece_minos[type][rotation];
+            PieceMask& mask = masks[type][rotation];
+            mask.min_x = mask.max_x = minos[0].x;
+            mask.min_y = mask.max_y = minos[0].y;
+            for (const Coord& mino : minos) {
+                mask.min_x = std::min(mask.min_x, mino.x);
+                mask.max_x = std::max(mask.max_x, mino.x);
+                mask.min_y = std::min(mask.min_y, mino.y);
+                mask.max_y = std::max(mask.max_y, mino.y);
+            }
+            for (const Coord& mino : minos)
+                mask.columns[mino.x - mask.min_x] |= 1u << (mino.y - mask.min_y);
+        }
+    }
+
+    return masks;
+}();
@@ -0,0 +1,251 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Game.hpp"
+#include "Move.hpp"
+#include "Piece.hpp"
+#include "SelfPlay.hpp"
+
+// cross checks the fast paths of the engine against the slower reference ones on positions taken from self play
+// every check returns how many comparisons disagreed and prints the first few to stderr
+class EngineCheck {
+public:
+    // mismatches printed per check, the rest are only counted
+    static constexpr size_t max_reported = 5;
+
+    // random against greedy self play, the random side leaves the overhangs and holes the fast paths have to get right
+    EngineCheck(size_t position_count, u32 seed) {
+        SelfPlay selfplay;
+        const SelfPlay::Policy random = SelfPlay::random_policy();
+        const SelfPlay::Policy greedy = SelfPlay::greedy_lines_policy();
+        for (u32 game = 0; positions.size() < position_count; game++) {
+            selfplay.play(1, random, greedy, seed + game, [&](const VersusGame& versus) {
+                for (int id = 0; id < 2 && positions.size() < position_count; id++)
+                    positions.push_back(versus.get_game(id));
+            });
+        }
+    }
+
+    size_t position_count() const {
+        return positions.size();
+    }
+
+    // the bitboard movegen finds the same placements as the bfs one, in any order
+    size_t movegen_engines() const {
+        size_t mismatches = 0;
+        for (size_t p = 0; p < positions.size(); p++) {
+            for (PieceType type : piece_types) {
+                std::vector<uint32_t> bfs = keys(positions[p].movegen(type, MovegenEngine::BFS));
+                std::vector<uint32_t> bitboard = keys(positions[p].movegen(type, MovegenEngine::Bitboard));
+                std::ranges::sort(bfs);
+                std::ranges::sort(bitboard);
+                if (bfs != bitboard)
+                    report(mismatches, "movegen", p, type, std::to_string(bfs.size()) + " bfs placements, " + std::to_string(bitboard.size()) + " bitboard");
+            }
+        }
+        return mismatches;
+    }
+
+    // the buffer overloads append exactly what the vector ones return, and leave what was in the buffer alone
+    size_t movegen_overloads() const {
+        size_t mismatches = 0;
+        Game::PlacementBuffer placements;
+        for (size_t p = 0; p < positions.size(); p++) {
+            const Game& game = positions[p];
+            for (PieceType type : piece_types) {
+                for (MovegenEngine engine : { MovegenEngine::BFS, MovegenEngine::Bitboard }) {
+                    const std::vector<Piece> expected = game.movegen(type, engine);
+
+                    // something already in the buffer, like the current piece's placements before the hold piece's
+                    placements.clear();
+                    game.movegen(PieceType::O, placements);
+                    const std::vector<uint32_t> before = keys(placements);
+
+                    const size_t count = game.movegen(type, placements, engine);
+                    const std::vector<uint32_t> after = keys(placements);
+                    if (count != expected.size() || after.size() != before.size() + count || !std::equal(before.begin(), before.end(), after.begin()) ||
+                        !std::equal(after.begin() + before.size(), after.end(), keys(expected).begin()))
+                        report(mismatches, "movegen overloads", p, type, std::to_string(expected.size()) + " placements, buffer got " + std::to_string(count));
+                }
+            }
+
+            const std::vector<uint32_t> expected = keys(game.get_possible_piece_placements());
+            placements.clear();
+            const size_t count = game.get_possible_piece_placements(placements);
+            if (count != expected.size() || keys(placements) != expected)
+                report(mismatches, "placement overloads", p, game.current_piece.type, std::to_string(expected.size()) + " placements, buffer got " + std::to_string(count));
+        }
+        return mismatches;
+    }
+
+    // apply ends where placing the move the way VersusGame does ends, and undo puts the game back exactly
+    // every placement is applied on its own, and a few in a row are undone in reverse
+    size_t apply_undo() const {
+        size_t mismatches = 0;
+        for (size_t p = 0; p < positions.size(); p++) {
+            Game game = positions[p];
+            if (game.current_piece.type == PieceType::Empty || hold_type(game) == PieceType::Empty)
+                continue;
+            // undo has to keep the cached heights and holes right too
+            game.board.set_surface_tracking(true);
+
+            const Game::UndoInfo null_undo = game.apply(Move());
+            game.undo(null_undo);
+            if (std::string difference = compare(game, positions[p]); !difference.empty())
+                report(mismatches, "null move undo", p, game.current_piece.type, difference);
+
+            for (const Piece& placement : game.get_possible_piece_placements()) {
+                Game expected = game;
+                Piece piece = placement;
+                expected.place_piece(piece);
+                const int lines = expected.board.clearLines();
+                const bool pc = std::ranges::all_of(expected.board.board, [](uint32_t column) { return column == 0; });
+                const int damage = expected.damage_sent(lines, piece.spin, pc);
+
+                const Game::UndoInfo undo = game.apply(Move(placement, false));
+                std::string difference = compare(game, expected);
+                if (difference.empty() && (undo.lines_cleared != lines || undo.damage != damage))
+                    difference = "lines or damage differ";
+                if (!difference.empty())
+                    report(mismatches, "apply", p, placement.type, difference);
+
+                game.undo(undo);
+                if (difference = compare(game, positions[p]); !difference.empty())
+                    report(mismatches, "undo", p, placement.type, difference);
+            }
+
+            // the first placement every time, until the queue runs out
+            std::vector<Game::UndoInfo> undos;
+            while (undos.size() < 4 && game.current_piece.type != PieceType::Empty && hold_type(game) != PieceType::Empty) {
+                const std::vector<Piece> placements = game.get_possible_piece_placements();
+                if (placements.empty())
+                    break;
+                undos.push_back(game.apply(Move(placements.front(), false)));
+            }
+            for (auto undo = undos.rbegin(); undo != undos.rend(); ++undo)
+                game.undo(*undo);
+            if (std::string difference = compare(game, positions[p]); !difference.empty())
+                report(mismatches, "chained undo", p, positions[p].current_piece.type, difference);
+        }
+        return mismatches;
+    }
+
+    // t_spin_type and t_spin_masks give the spin the three corner rule gives, read one cell at a time
+    // every origin and rotation is checked, not only where a T fits
+    size_t t_spins() const {
+        size_t mismatches = 0;
+        for (size_t p = 0; p < positions.size(); p++) {
+            const Board& board = positions[p].board;
+            for (int r = 0; r < RotationDirections_N; r++) {
+                const Game::TSpinMasks masks = Game::t_spin_masks(board, RotationDirection(r));
+                for (int x = 0; x < Board::width; x++) {
+                    for (int y = 0; y < Board::height; y++) {
+                        const Piece piece(PieceType::T, Coord{ int8_t(x), int8_t(y) }, RotationDirection(r), spinType::null);
+                        for (int kick = 0; kick < srs_kicks; kick++) {
+                            const spinType expected = corner_scan(board, piece, kick);
+                            if (Game::t_spin_type(board, piece, kick) != expected)
+                                report(mismatches, "t spin type", p, PieceType::T,
+                                       "x " + std::to_string(x) + ", y " + std::to_string(y) + ", rotation " + std::to_string(r) + ", kick " + std::to_string(kick));
+                        }
+
+                        const spinType first_kick = corner_scan(board, piece, 0);
+                        if (((masks.normal[x] >> y) & 1) != (first_kick == spinType::normal) || ((masks.mini[x] >> y) & 1) != (first_kick == spinType::mini))
+                            report(mismatches, "t spin masks", p, PieceType::T,
+                                   "x " + std::to_string(x) + ", y " + std::to_string(y) + ", rotation " + std::to_string(r));
+                    }
+                }
+            }
+        }
+        return mismatches;
+    }
+
+private:
+    static constexpr PieceType piece_types[] = { PieceType::S, PieceType::Z, PieceType::J, PieceType::L, PieceType::T, PieceType::O, PieceType::I };
+
+    // a placement as one number, two placements that differ only in their spin are different
+    static uint32_t key(const Piece& piece) {
+        return piece.compact_hash() * 3 + uint32_t(piece.spin);
+    }
+
+    template <typename Placements>
+    static std::vector<uint32_t> keys(const Placements& placements) {
+        std::vector<uint32_t> out;
+        out.reserve(placements.size());
+        for (const Piece& piece : placements)
+            out.push_back(key(piece));
+        return out;
+    }
+
+    // the walls and the floor count as filled, above the board counts as empty
+    static spinType corner_scan(const Board& board, const Piece& piece, int kick) {
+        auto filled = [&board](int x, int y) {
+            if (x < 0 || x >= Board::width || y < 0)
+                return true;
+            return y < Board::height && board.get(x, y) != 0;
+        };
+        const int x = piece.position.x;
+        const int y = piece.position.y;
+        // in the order of t_spin_corners
+        const std::array<bool, 4> corners = { filled(x - 1, y - 1), filled(x - 1, y + 1), filled(x + 1, y - 1), filled(x + 1, y + 1) };
+        const std::array<uint8_t, 4>& order = t_spin_corners[piece.rotation];
+        const int front = corners[order[0]] + corners[order[1]];
+        const int back = corners[order[2]] + corners[order[3]];
+
+        if (front == 2 && back >= 1)
+            return spinType::normal;
+        if (front >= 1 && back == 2)
+            return kick == srs_kicks - 1 ? spinType::normal : spinType::mini;
+        return spinType::null;
+    }
+
+    static PieceType hold_type(const Game& game) {
+        return game.hold.has_value() ? game.hold->type : game.queue.front();
+    }
+
+    static bool same_piece(const Piece& a, const Piece& b) {
+        return a.type == b.type && a.rotation == b.rotation && a.position.x == b.position.x && a.position.y == b.position.y && a.spin == b.spin;
+    }
+
+    // what differs between the two games, empty if nothing does
+    // the hash and the cached surface of the first are also checked against ones computed from its columns
+    static std::string compare(const Game& game, const Game& expected) {
+        if (game.board.board != expected.board.board)
+            return "board differs";
+        Board rebuilt = game.board;
+        rebuilt.rehash();
+        if (game.board.get_hash() != expected.board.get_hash() || game.board.get_hash() != rebuilt.get_hash())
+            return "hash differs";
+        rebuilt.set_surface_tracking(true);
+        for (size_t x = 0; x < Board::width; x++) {
+            if (game.board.column_height(x) != rebuilt.column_height(x))
+                return "height of column " + std::to_string(x) + " differs";
+        }
+        if (game.board.get_holes() != rebuilt.get_holes())
+            return "holes differ";
+        if (!same_piece(game.current_piece, expected.current_piece))
+            return "current piece differs";
+        if (game.hold.has_value() != expected.hold.has_value() || (game.hold && !same_piece(*game.hold, *expected.hold)))
+            return "hold differs";
+        if (game.queue != expected.queue)
+            return "queue differs";
+        const TetrioStats& a = game.stats;
+        const TetrioStats& b = expected.stats;
+        if (a.combo != b.combo || a.b2b != b.b2b || a.currentcombopower != b.currentcombopower || a.currentbtbchainpower != b.currentbtbchainpower)
+            return "stats differ";
+        if (game.garbage_meter != expected.garbage_meter)
+            return "garbage meter differs";
+        return {};
+    }
+
+    static void report(size_t& mismatches, const char* check, size_t position, PieceType type, const std::string& detail) {
+        if (mismatches++ < max_reported)
+            std::cerr << check << ": position " << position << ", piece " << int(type) << ": " << detail << std::endl;
+    }
+
+    std::vector<Game> positions;
+};
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <bit>
+#include <bitset>
 #include <iostream>
 #include <map>
 #include <random>
@@ -39,20 +40,90 @@ bool Game::place_piece(Piece& piece) {
     return first_hold;
 }
 
-bool Game::collides(const Board& board, const Piece& piece) const {
-    for (auto& mino : piece.minos) {
-        int x_pos = mino.x + piece.position.x;
-        if (x_pos < 0 || x_pos >= Board::width)
-            return true;
-
-        int y_pos = mino.y + piece.position.y;
-        if (y_pos < 0 || y_pos >= Board::height)
-            return true;
-        if (board.get(x_pos, y_pos))
-            return true;
+Game::UndoInfo Game::apply(const Move& move) {
+    UndoInfo undo{ move.piece, {}, 0, current_piece, hold, queue, stats, move.null_move, 0, 0 };
+
+    if (move.null_move)
+        return undo;
+
+    const PieceMask& mask = piece_masks[static_cast<size_t>(move.piece.type)][move.piece.rotation];
+    for (int c = 0; c <= mask.max_x - mask.min_x; c++) {
+        const int x = move.piece.position.x + mask.min_x + c;
+        const int y = move.piece.position.y + mask.min_y;
+        undo.covered[c] = board.board[x] & (mask.columns[c] << y);
     }
 
-    return false;
+    Piece piece = move.piece;
+    place_piece(piece);
+
+    undo.cleared_rows = board.full_rows();
+    undo.lines_cleared = board.clearLines();
+
+    bool pc = std::ranges::all_of(board.board, [](uint32_t column) { return column == 0; });
+
+    undo.damage = damage_sent(undo.lines_cleared, piece.spin, pc);
+
+    return undo;
+}
+
+void Game::undo(const UndoInfo& undo) {
+    if (!undo.null_move) {
+        board.restore_rows(undo.cleared_rows);
+        board.unset(undo.placed);
+
+        const PieceMask& mask = piece_masks[static_cast<size_t>(undo.placed.type)][undo.placed.rotation];
+        for (int c = 0; c <= mask.max_x - mask.min_x; c++) {
+            for (uint32_t covered = undo.covered[c]; covered; covered &= covered - 1)
+                board.set(undo.placed.position.x + mask.min_x + c, std::countr_zero(covered));
+        }
+    }
+
+    current_piece = undo.current_piece;
+    hold = undo.hold;
+    queue = undo.queue;
+    stats = undo.stats;
+}
+
+bool Game::collides(const Board& board, const Piece& piece) const {
+    return board.collides(piece);
+}
+
+// the corners around every origin in column x at once, in the order t_spin_corners uses
+// bit y of each mask is the corner of the origin (x, y), the walls and the floor count as filled
+static std::array<uint32_t, 4> t_spin_corner_masks(const Board& board, int x) {
+    // moved up a row so bit y is the row below y and the floor fits in bit 0
+    const uint64_t left = x > 0 ? uint64_t(board.board[x - 1]) << 1 | 1 : UINT64_MAX;
+    const uint64_t right = x + 1 < Board::width ? uint64_t(board.board[x + 1]) << 1 | 1 : UINT64_MAX;
+    return { uint32_t(left), uint32_t(left >> 2), uint32_t(right), uint32_t(right >> 2) };
+}
+
+// the normal and mini spin origins of one column
+static std::pair<uint32_t, uint32_t> t_spin_column(const Board& board, RotationDirection rotation, int x) {
+    const std::array<uint32_t, 4> corners = t_spin_corner_masks(board, x);
+    const std::array<uint8_t, 4>& order = t_spin_corners[rotation];
+    const uint32_t front = corners[order[0]] & corners[order[1]];
+    const uint32_t front_any = corners[order[0]] | corners[order[1]];
+    const uint32_t back = corners[order[2]] & corners[order[3]];
+    const uint32_t back_any = corners[order[2]] | corners[order[3]];
+
+    // both front corners and a back one, or one front corner and both back ones
+    const uint32_t normal = front & back_any;
+    const uint32_t mini = front_any & back & ~normal;
+    return { normal, mini };
+}
+
+Game::TSpinMasks Game::t_spin_masks(const Board& board, RotationDirection rotation) {
+    TSpinMasks masks;
+    for (int x = 0; x < Board::width; x++)
+        std::tie(masks.normal[x], masks.mini[x]) = t_spin_column(board, rotation, x);
+    return masks;
+}
+
+spinType Game::t_spin_type(const Board& board, const Piece& piece, int kick) {
+    const auto [normal, mini] = t_spin_column(board, piece.rotation, piece.position.x);
+    const int y = piece.position.y;
+    const int last_kick = kick >= srs_kicks - 1;
+    return spinType(((normal >> y) & 1) * 2 + ((mini >> y) & 1) * (1 + last_kick));
 }
 
 void Game::rotate(Piece& piece, TurnDirection dir) const {
@@ -60,56 +131,17 @@ void Game::rotate(Piece& piece, TurnDirection dir) const {
 
     piece.rotate(dir);
 
-    const std::array<Coord, srs_kicks>* offsets = &piece_offsets_JLSTZ[piece.rotation];
-    const std::array<Coord, srs_kicks>* prev_offsets = &piece_offsets_JLSTZ[prev_rot];
-
-    if (piece.type == PieceType::I) {
-        prev_offsets = &piece_offsets_I[prev_rot];
-        offsets = &piece_offsets_I[piece.rotation];
-    }
-    else if (piece.type == PieceType::O) {
-        prev_offsets = &piece_offsets_O[prev_rot];
-        offsets = &piece_offsets_O[piece.rotation];
-    }
+    const std::array<Coord, srs_kicks>& kicks = piece_kicks[static_cast<size_t>(piece.type)][prev_rot][dir];
 
     auto x = piece.position.x;
     auto y = piece.position.y;
 
     for (int i = 0; i < srs_kicks; i++) {
-        piece.position.x = x + (*prev_offsets)[i].x - (*offsets)[i].x;
-        piece.position.y = y + (*prev_offsets)[i].y - (*offsets)[i].y;
+        piece.position.x = x + kicks[i].x;
+        piece.position.y = y + kicks[i].y;
         if (!collides(board, piece)) {
-            if (piece.type == PieceType::T) {
-                constexpr std::array<std::array<Coord, 4>, 4> corners = { {
-                        // a       b       c        d
-                        {{{-1, 1}, {1, 1}, {1, -1}, {-1, -1}}},  // North
-                        {{{1, 1}, {1, -1}, {-1, -1}, {-1, 1}}},  // East
-                        {{{1, -1}, {-1, -1}, {-1, 1}, {1, 1}}},  // South
-                        {{{-1, -1}, {-1, 1}, {1, 1}, {1, -1}}},  // West
-                    } };
-
-                bool filled[4] = { true, true, true, true };
-
-                for (int u = 0; u < 4; u++) {
-                    Coord c = corners[piece.rotation][u];
-                    c.x += piece.position.x;
-                    c.y += piece.position.y;
-                    if (c.x >= 0 && c.x < Board::width)
-                        filled[u] = board.get(c.x, c.y);
-                }
-
-                if (filled[0] && filled[1] && (filled[2] || filled[3]))
-                    piece.spin = spinType::normal;
-                else if ((filled[0] || filled[1]) && filled[2] && filled[3]) {
-                    if (i >= (srs_kicks - 1)) {
-                        piece.spin = spinType::normal;
-                    }
-                    else
-                        piece.spin = spinType::mini;
-                }
-                else
-                    piece.spin = spinType::null;
-            }
+            if (piece.type == PieceType::T)
+                piece.spin = t_spin_type(board, piece, i);
             return;
         }
     }
@@ -131,13 +163,17 @@ void Game::shift(Piece& piece, int dir) const {
 
 void Game::sonic_drop(const Board& board, Piece& piece) const {
     int distance = 32;
-    for (auto& mino : piece.minos) {
+    for (auto& mino : piece.minos()) {
 
         int mino_height = mino.y + piece.position.y;
-
-        uint32_t column = board.board[mino.x + piece.position.x];
-
-        if (column && mino_height != 0) {
+        const int x = mino.x + piece.position.x;
+
+        // above the stack the floor is the column height, cached when the board tracks its surface
+        const int column_height = board.column_height(x);
+        if (mino_height >= column_height) {
+            mino_height -= column_height;
+        } else if (mino_height != 0) {
+            uint32_t column = board.board[x];
             int air = 32 - mino_height;
             mino_height -= 32 - std::countl_zero((column << air) >> air);
         }
@@ -149,15 +185,7 @@ void Game::sonic_drop(const Board& board, Piece& piece) const {
 }
 
 void Game::add_garbage(int lines, int location) {
-    for (int i = 0; i < Board::width; ++i) {
-        auto& column = board.board[i];
-
-        column <<= lines;
-
-        if (location != i) {
-            column |= (1 << lines) - 1;
-        }
-    }
+    board.add_garbage(lines, location);
 }
 
 // ported from
@@ -180,58 +208,81 @@ void Game::process_movement(Piece& piece, Movement movement) const {
     case Movement::RotateCounterClockwise:
         rotate(piece, TurnDirection::Left);
         break;
-    case Movement::SonicDrop:
+    case Movement::SonicDrop: {
+        const int y = piece.position.y;
         sonic_drop(board, piece);
+        // like a shift, a drop that moves the piece loses the spin of the rotation before it
+        if (piece.position.y != y)
+            piece.spin = spinType::null;
         break;
+    }
         // default:
         // std::unreachable();
     }
 }
 
-std::vector<Piece> Game::movegen(PieceType piece_type) const {
-    Piece initial_piece = Piece(piece_type);
+std::vector<Piece> Game::movegen(PieceType piece_type, MovegenEngine engine) const {
+    PlacementBuffer placements;
+    movegen(piece_type, placements, engine);
+    return std::vector<Piece>(placements.begin(), placements.end());
+}
 
-    std::vector<Piece> open_nodes;
-    open_nodes.reserve(150);
-    std::vector<Piece> next_nodes;
-    next_nodes.reserve(150);
-    std::vector<bool> visited = std::vector<bool>(6444);
+size_t Game::movegen(PieceType piece_type, PlacementBuffer& placements, MovegenEngine engine) const {
+    if (engine == MovegenEngine::BFS)
+        return movegen_bfs(piece_type, placements);
+    return movegen_bitboard(piece_type, placements);
+}
 
-    std::vector<Piece> valid_moves;
-    valid_moves.reserve(100);
+size_t Game::movegen_bfs(PieceType piece_type, PlacementBuffer& placements) const {
+    const size_t initial_size = placements.size();
+    Piece initial_piece = Piece(piece_type);
+
+    // a node is a position and the spin it was reached with, so a spot reached without a spin can still be reached with one
+    // a node is marked as visited when it is queued, so a level never holds more nodes than there are position and spin pairs
+    static_vector<Piece, max_placements * 3> open_nodes;
+    static_vector<Piece, max_placements * 3> next_nodes;
+    std::bitset<6444 * 3> visited;
+    // where each grounded position is in placements, it is reported once with the best spin it can be reached with
+    std::array<int16_t, 6444> placement_index;
+    placement_index.fill(-1);
+
+    auto queue_node = [&](const Piece& piece) {
+        auto h = piece.compact_hash() * 3 + static_cast<size_t>(piece.spin);
+        if (visited[h])
+            return;
+        // mark node as visited
+        visited[h] = true;
+        next_nodes.emplace_back(piece);
+    };
 
     // root node
-    open_nodes.emplace_back(initial_piece);
+    queue_node(initial_piece);
+    open_nodes = next_nodes;
+    next_nodes.clear();
 
     while (open_nodes.size() > 0) {
         // expand edges
         for (auto& piece : open_nodes) {
-            auto h = piece.compact_hash();
-            if (visited[h])
-                continue;
-            // mark node as visited
-            visited[h] = true;
-
             // try all movements
             Piece new_piece = piece;
             process_movement(new_piece, Movement::RotateCounterClockwise);
-            next_nodes.emplace_back(new_piece);
+            queue_node(new_piece);
 
             new_piece = piece;
             process_movement(new_piece, Movement::RotateClockwise);
-            next_nodes.emplace_back(new_piece);
+            queue_node(new_piece);
 
             new_piece = piece;
             process_movement(new_piece, Movement::Left);
-            next_nodes.emplace_back(new_piece);
+            queue_node(new_piece);
 
             new_piece = piece;
             process_movement(new_piece, Movement::Right);
-            next_nodes.emplace_back(new_piece);
+            queue_node(new_piece);
 
             new_piece = piece;
             process_movement(new_piece, Movement::SonicDrop);
-            next_nodes.emplace_back(new_piece);
+            queue_node(new_piece);
 
             // check if the piece is grounded and therefore valid
 
@@ -239,30 +290,208 @@ std::vector<Piece> Game::movegen(PieceType piece_type) const {
 
             if (collides(board, piece)) {
                 piece.position.y++;
-                valid_moves.emplace_back(piece);
+                int16_t& index = placement_index[piece.compact_hash()];
+                if (index == -1) {
+                    index = int16_t(placements.size() - initial_size);
+                    placements.emplace_back(piece);
+                } else if (piece.spin > placements[initial_size + index].spin) {
+                    placements[initial_size + index].spin = piece.spin;
+                }
             }
         }
         open_nodes = next_nodes;
         next_nodes.clear();
     }
 
-    return valid_moves;
+    return placements.size() - initial_size;
 }
 
-// warning! if there is a piece in the hold and the current piece is empty, we dont use the hold
-std::vector<Piece> Game::get_possible_piece_placements() const {
+// one bit per piece origin, bit y of column x is the position (x, y)
+using PositionMasks = std::array<uint32_t, Board::width>;
+
+// every origin where a piece with these minos fits inside the board without overlapping anything
+static PositionMasks free_positions(const Board& board, const std::array<Coord, 4>& minos) {
+    PositionMasks free{};
+    for (int x = 0; x < Board::width; x++) {
+        uint32_t mask = UINT32_MAX;
+        for (const Coord& mino : minos) {
+            int column = x + mino.x;
+            if (column < 0 || column >= Board::width) {
+                mask = 0;
+                break;
+            }
+            uint32_t empty = ~board.board[column];
+            mask &= mino.y >= 0 ? empty >> mino.y : empty << -mino.y;
+        }
+        free[x] = mask;
+    }
+    return free;
+}
 
-    std::vector<Piece> valid_pieces = movegen(current_piece.type);
+// moves every position by (dx, dy), positions pushed off the board are dropped
+static PositionMasks shift_positions(const PositionMasks& positions, int dx, int dy) {
+    PositionMasks shifted{};
+    constexpr int width = Board::width;
+    for (int x = std::max(0, -dx); x < std::min(width, width - dx); x++) {
+        shifted[x + dx] = dy >= 0 ? positions[x] << dy : positions[x] >> -dy;
+    }
+    return shifted;
+}
 
-    PieceType holdType = hold.has_value() ? hold->type : queue.front();
+// where a sonic drop from any of the positions lands, free must contain the positions
+static uint32_t sonic_drop_positions(uint32_t positions, uint32_t free) {
+    // smear the positions downwards through the free cells
+    positions |= (positions >> 1) & free;
+    free &= free >> 1;
+    positions |= (positions >> 2) & free;
+    free &= free >> 2;
+    positions |= (positions >> 4) & free;
+    free &= free >> 4;
+    positions |= (positions >> 8) & free;
+    free &= free >> 8;
+    positions |= (positions >> 16) & free;
+    return positions;
+}
 
-    std::vector<Piece> hold_pieces = movegen(holdType);
-    valid_pieces.reserve(valid_pieces.size() + hold_pieces.size());
+// reaches new positions in a column from itself and its neighbours by shifting and sonic dropping
+static bool expand_column(PositionMasks& positions, const PositionMasks& free, int x) {
+    uint32_t reached = positions[x];
+    if (x > 0)
+        reached |= positions[x - 1];
+    if (x < Board::width - 1)
+        reached |= positions[x + 1];
+    reached &= free[x];
+
+    uint32_t dropped = sonic_drop_positions(reached, free[x]);
+    // only keep where the drop stopped, not the cells it fell through
+    reached |= dropped & ~(free[x] << 1);
+
+    if (reached == positions[x])
+        return false;
+    positions[x] = reached;
+    return true;
+}
+
+// expands the positions of one rotation by shifting and sonic dropping until nothing new is reached
+static void expand_rotation(PositionMasks& positions, const PositionMasks& free) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        // sweep both ways so shifts travel across the whole board in one pass
+        for (int x = 0; x < Board::width; x++)
+            changed |= expand_column(positions, free, x);
+        for (int x = Board::width - 1; x >= 0; x--)
+            changed |= expand_column(positions, free, x);
+    }
+}
+
+size_t Game::movegen_bitboard(PieceType piece_type, PlacementBuffer& placements) const {
+    const Piece initial_piece = Piece(piece_type);
+
+    // where the piece fits in each rotation
+    std::array<PositionMasks, RotationDirections_N> free;
+    for (int r = 0; r < RotationDirections_N; r++)
+        free[r] = free_positions(board, piece_minos[static_cast<size_t>(piece_type)][r]);
 
+    // a spawn that already collides doesnt fit the flood fill, let the reference implementation deal with it
+    if (!((free[North][initial_piece.position.x] >> initial_piece.position.y) & 1))
+        return movegen_bfs(piece_type, placements);
 
-    for (auto& piece : hold_pieces) {
-        valid_pieces.emplace_back(piece);
+    const auto& kicks = piece_kicks[static_cast<size_t>(piece_type)];
+
+    std::array<PositionMasks, RotationDirections_N> reached{};
+    reached[North][initial_piece.position.x] = 1u << initial_piece.position.y;
+
+    // positions that were rotated into, and the ones rotated into with the last kick, used for classifying t spins
+    std::array<PositionMasks, RotationDirections_N> kicked_into{};
+    std::array<PositionMasks, RotationDirections_N> last_kicked_into{};
+
+    // rotations that reached new positions since they were last expanded
+    std::array<bool, RotationDirections_N> dirty = { true, false, false, false };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int r = 0; r < RotationDirections_N; r++) {
+            if (!dirty[r])
+                continue;
+            dirty[r] = false;
+            expand_rotation(reached[r], free[r]);
+
+            for (TurnDirection direction : { TurnDirection::Right, TurnDirection::Left }) {
+                const int next = (r + (direction == TurnDirection::Right ? 1 : 3)) % RotationDirections_N;
+
+                // kicks are tried in order, a position only uses the first kick that fits
+                PositionMasks remaining = reached[r];
+                for (int i = 0; i < srs_kicks; i++) {
+                    if (std::ranges::all_of(remaining, [](uint32_t column) { return column == 0; }))
+                        break;
+
+                    const int dx = kicks[r][direction][i].x;
+                    const int dy = kicks[r][direction][i].y;
+
+                    PositionMasks kicked = shift_positions(remaining, dx, dy);
+                    const PositionMasks fits = shift_positions(free[next], -dx, -dy);
+                    for (int x = 0; x < Board::width; x++) {
+                        kicked[x] &= free[next][x];
+                        remaining[x] &= ~fits[x];
+
+                        if (piece_type == PieceType::T) {
+                            kicked_into[next][x] |= kicked[x];
+                            if (i == srs_kicks - 1)
+                                last_kicked_into[next][x] |= kicked[x];
+                        }
+                        if (kicked[x] & ~reached[next][x]) {
+                            reached[next][x] |= kicked[x];
+                            dirty[next] = true;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    const size_t initial_size = placements.size();
+
+    for (int r = 0; r < RotationDirections_N; r++) {
+        TSpinMasks spins{};
+        if (piece_type == PieceType::T)
+            spins = t_spin_masks(board, RotationDirection(r));
+
+        for (int x = 0; x < Board::width; x++) {
+            // the same spot can be rotated into from several places, the best spin is reported
+            const uint32_t normal = (spins.normal[x] & kicked_into[r][x]) | (spins.mini[x] & last_kicked_into[r][x]);
+            const uint32_t mini = spins.mini[x] & kicked_into[r][x] & ~normal;
+
+            // grounded when moving the piece one cell down would collide
+            uint32_t grounded = reached[r][x] & ~(free[r][x] << 1);
+            while (grounded) {
+                const int y = std::countr_zero(grounded);
+                grounded &= grounded - 1;
+
+                const spinType spin = spinType(((normal >> y) & 1) * 2 + ((mini >> y) & 1));
+                placements.emplace_back(piece_type, Coord{ (int8_t)x, (int8_t)y }, RotationDirection(r), spin);
+            }
+        }
     }
 
-    return valid_pieces;
+    return placements.size() - initial_size;
+}
+
+// warning! if there is a piece in the hold and the current piece is empty, we dont use the hold
+std::vector<Piece> Game::get_possible_piece_placements() const {
+    PlacementBuffer placements;
+    get_possible_piece_placements(placements);
+    return std::vector<Piece>(placements.begin(), placements.end());
+}
+
+size_t Game::get_possible_piece_placements(PlacementBuffer& placements) const {
+    size_t count = movegen(current_piece.type, placements);
+
+    PieceType holdType = hold.has_value() ? hold->type : queue.front();
+
+    count += movegen(holdType, placements);
+
+    return count;
 }
\ No newline at end of file
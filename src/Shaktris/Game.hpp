@@ -10,13 +10,29 @@
 #include "Piece.hpp"
 #include "Constants.hpp"
 #include "rng.hpp"
+#include "static_vector.hpp"
 #include "tetrio.hpp"
 
+// which implementation Game::movegen uses, both produce the same placements
+enum class MovegenEngine : u8 {
+    // expands one piece at a time, kept around as the reference implementation
+    BFS,
+    // flood fills every position of a rotation at once over the board columns
+    Bitboard,
+};
 
 class Game {
 
 public:
     static constexpr int queue_size = 5;
+
+    // every position a single piece type can be in, an upper bound for the placements movegen finds
+    static constexpr size_t max_placements = RotationDirections_N * Board::width * Board::height;
+
+    // room for the placements of the current piece and the hold piece
+    // movegen appends, so a buffer is cleared before the first piece, a third piece without clearing can throw std::length_error
+    using PlacementBuffer = static_vector<Piece, 2 * max_placements>;
+
     Game() : current_piece(PieceType::Empty) {
         for (auto& p : queue) {
             p = PieceType::Empty;
@@ -35,6 +51,30 @@ public:
     }
     ~Game() {}
 
+    // everything apply changes, enough for undo to put the game back exactly
+    struct UndoInfo {
+        Piece placed;
+        // cells the placement landed on that were already filled, only happens when placing into a topped out spawn
+        std::array<uint32_t, 4> covered;
+        // rows the placement cleared, as they were on the board before clearing
+        uint32_t cleared_rows;
+        Piece current_piece;
+        std::optional<Piece> hold;
+        std::array<PieceType, queue_size> queue;
+        TetrioStats stats;
+        bool null_move;
+
+        // results of the move
+        int lines_cleared;
+        int damage;
+    };
+
+    // places the piece, holding if needed, clears lines and counts the damage it sends
+    UndoInfo apply(const Move& move);
+
+    // takes back a move, undos have to be done in the reverse order of the applies
+    void undo(const UndoInfo& undo);
+
     void place_piece();
 
     bool place_piece(Piece& piece);
@@ -43,6 +83,18 @@ public:
 
     void rotate(Piece& piece, TurnDirection dir) const;
 
+    // origins of a T in one rotation whose corners make a spin, bit y of column x is the origin (x, y)
+    struct TSpinMasks {
+        std::array<uint32_t, Board::width> normal;
+        // rotating in with the last kick turns these into normal spins
+        std::array<uint32_t, Board::width> mini;
+    };
+
+    static TSpinMasks t_spin_masks(const Board& board, RotationDirection rotation);
+
+    // classifies a T piece that was just rotated into place with the given kick
+    static spinType t_spin_type(const Board& board, const Piece& piece, int kick);
+
     void shift(Piece& piece, int dir) const;
 
     void sonic_drop(const Board& board, Piece& piece) const;
@@ -53,10 +105,19 @@ public:
 
     void process_movement(Piece& piece, Movement movement) const;
 
-    std::vector<Piece> movegen(PieceType piece_type) const;
+    std::vector<Piece> movegen(PieceType piece_type, MovegenEngine engine = MovegenEngine::Bitboard) const;
+
+    // appends the placements to the buffer without allocating, returns how many were added
+    size_t movegen(PieceType piece_type, PlacementBuffer& placements, MovegenEngine engine = MovegenEngine::Bitboard) const;
+
+    size_t movegen_bfs(PieceType piece_type, PlacementBuffer& placements) const;
+
+    size_t movegen_bitboard(PieceType piece_type, PlacementBuffer& placements) const;
 
     std::vector<Piece> get_possible_piece_placements() const;
 
+    size_t get_possible_piece_placements(PlacementBuffer& placements) const;
+
     Board board;
     Piece current_piece;
     std::optional<Piece> hold;
@@ -0,0 +1,147 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Board.hpp"
+#include "Game.hpp"
+#include "Piece.hpp"
+
+// bounded transposition table of movegen results keyed by (board hash, piece type)
+// lookups and stores never block, so a single cache can be shared by every thread
+// each slot is a seqlock, a reader that races a writer just sees a miss and a writer that races another writer skips storing
+class MovegenCache {
+public:
+    // results with more placements than this are not cached
+    static constexpr size_t max_cached_placements = 256;
+
+    // owned by the caller, one per thread, so counting never makes threads share a cache line
+    struct Counters {
+        size_t hits = 0;
+        size_t misses = 0;
+
+        void merge(const Counters& other) {
+            hits += other.hits;
+            misses += other.misses;
+        }
+    };
+
+    explicit MovegenCache(size_t slot_count_log2 = 14)
+        : slots(std::make_unique<Slot[]>(size_t(1) << slot_count_log2)),
+          index_mask((size_t(1) << slot_count_log2) - 1) {}
+
+    MovegenCache(const MovegenCache&) = delete;
+    MovegenCache& operator=(const MovegenCache&) = delete;
+
+    // appends the placements of the piece type on the games board, running movegen on a miss
+    size_t movegen(const Game& game, PieceType piece_type, Game::PlacementBuffer& placements, Counters* counters = nullptr) {
+        const size_t initial_size = placements.size();
+        if (lookup(game.board, piece_type, placements, counters))
+            return placements.size() - initial_size;
+
+        const size_t count = game.movegen(piece_type, placements);
+        store(game.board, piece_type, std::span<const Piece>(placements.begin() + initial_size, count));
+        return count;
+    }
+
+    std::vector<Piece> movegen(const Game& game, PieceType piece_type, Counters* counters = nullptr) {
+        Game::PlacementBuffer placements;
+        movegen(game, piece_type, placements, counters);
+        return std::vector<Piece>(placements.begin(), placements.end());
+    }
+
+    // appends the cached placements, returns false on a miss without touching the buffer
+    bool lookup(const Board& board, PieceType piece_type, Game::PlacementBuffer& placements, Counters* counters = nullptr) {
+        const uint64_t key = make_key(board, piece_type);
+        const Slot& slot = slots[key & index_mask];
+
+        const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            if (counters)
+                counters->misses++;
+            return false;
+        }
+
+        const uint64_t slot_key = slot.key.load(std::memory_order_relaxed);
+        const size_t count = slot.count.load(std::memory_order_relaxed);
+
+        std::array<uint64_t, max_cached_placements / 4> packed;
+        for (size_t i = 0; i < (count + 3) / 4; i++)
+            packed[i] = slot.placements[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot_key != key || slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            if (counters)
+                counters->misses++;
+            return false;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            const uint16_t placement = packed[i / 4] >> (16 * (i % 4));
+            placements.emplace_back(piece_type,
+                Coord{ int8_t((placement >> 2) & 15), int8_t((placement >> 6) & 31) },
+                RotationDirection(placement & 3),
+                spinType((placement >> 11) & 3));
+        }
+
+        if (counters)
+            counters->hits++;
+        return true;
+    }
+
+    void store(const Board& board, PieceType piece_type, std::span<const Piece> placements) {
+        if (placements.size() > max_cached_placements)
+            return;
+
+        const uint64_t key = make_key(board, piece_type);
+        Slot& slot = slots[key & index_mask];
+
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        if ((sequence & 1) || !slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire))
+            return;
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < placements.size(); i += 4) {
+            uint64_t word = 0;
+            for (size_t j = i; j < std::min(i + 4, placements.size()); j++)
+                word |= uint64_t(pack(placements[j])) << (16 * (j - i));
+            slot.placements[i / 4].store(word, std::memory_order_relaxed);
+        }
+        slot.count.store(uint16_t(placements.size()), std::memory_order_relaxed);
+        slot.key.store(key, std::memory_order_relaxed);
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+private:
+    static constexpr std::array<uint64_t, 8> piece_type_keys = {
+        0x9e3779b97f4a7c15, 0xbf58476d1ce4e5b9, 0x94d049bb133111eb, 0x2545f4914f6cdd1d,
+        0xd6e8feb86659fd93, 0xa0761d6478bd642f, 0xe7037ed1a0b428db, 0x8ebc6af09c88c6e3,
+    };
+
+    static uint64_t make_key(const Board& board, PieceType piece_type) {
+        return board.get_hash() ^ piece_type_keys[static_cast<size_t>(piece_type)];
+    }
+
+    // rotation in bits 0-1, x in bits 2-5, y in bits 6-10 and spin in bits 11-12
+    static uint16_t pack(const Piece& piece) {
+        return uint16_t(piece.rotation | (piece.position.x << 2) | (piece.position.y << 6) | (static_cast<int>(piece.spin) << 11));
+    }
+
+    struct Slot {
+        // odd while a writer owns the slot
+        std::atomic<uint32_t> sequence{ 0 };
+        std::atomic<uint16_t> count{ 0 };
+        std::atomic<uint64_t> key{ 0 };
+        // four packed placements per word
+        std::array<std::atomic<uint64_t>, max_cached_placements / 4> placements{};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t index_mask;
+};
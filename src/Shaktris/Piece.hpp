@@ -4,13 +4,13 @@
 
 #include "Constants.hpp"
 
+// a piece is only its type, rotation, position and spin, the minos come from the constexpr tables
 class Piece {
 public:
     Piece(PieceType type) {
         this->type = type;
         rotation = RotationDirection::North;
         position = { 10 / 2 - 1, 20 - 1 };
-        minos = piece_definitions[static_cast<size_t>(type)];
         spin = spinType::null;
     }
     Piece(PieceType type, Coord position, RotationDirection rotation, spinType spin) {
@@ -18,11 +18,6 @@ public:
         this->position = position;
         this->rotation = rotation;
         this->spin = spin;
-        minos = piece_definitions[static_cast<size_t>(type)];
-
-        for (int i = 0; i < static_cast<int>(rotation); i++) {
-            rotate(TurnDirection::Right);
-        }
     }
 
     Piece() = delete;
@@ -32,22 +27,15 @@ public:
     Piece& operator=(const Piece& other) = default;
 
     inline void rotate(TurnDirection direction) {
-        if (direction == TurnDirection::Left) {
+        if (direction == TurnDirection::Left)
             rotation = static_cast<RotationDirection>((static_cast<int>(rotation) + 3) % 4);
-            for (auto& mino : minos) {
-                Coord temp_mino = mino;
-                temp_mino.y *= -1;
-                mino = { temp_mino.y, temp_mino.x };
-            }
-        }
-        else {
+        else
             rotation = static_cast<RotationDirection>((static_cast<int>(rotation) + 1) % 4);
-            for (auto& mino : minos) {
-                Coord temp_mino = mino;
-                temp_mino.x *= -1;
-                mino = { temp_mino.y, temp_mino.x };
-            }
-        }
+    }
+
+    // offsets of the four minos from the position
+    inline const std::array<Coord, 4>& minos() const {
+        return piece_minos[static_cast<size_t>(type)][rotation];
     }
 
     inline uint32_t compact_hash() const {
@@ -55,9 +43,10 @@ public:
     }
 
 
-    std::array<Coord, 4> minos;
     Coord position;
     RotationDirection rotation;
     PieceType type;
     spinType spin;
-};
\ No newline at end of file
+};
+
+static_assert(sizeof(Piece) == 5);
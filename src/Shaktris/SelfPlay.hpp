@@ -0,0 +1,162 @@
+#pragma once
+#include <bit>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "Game.hpp"
+#include "Move.hpp"
+#include "MovegenCache.hpp"
+#include "Piece.hpp"
+#include "VersusGame.hpp"
+#include "rng.hpp"
+
+// plays VersusGames between built in policies without any bot processes, as fast as the engine allows
+class SelfPlay {
+public:
+    // picks one of the placements of the current and hold piece, nullopt plays a null move
+    using Policy = std::function<std::optional<Piece>(const Game& game, std::span<const Piece> placements, RNG& rng)>;
+
+    // called after every turn, for recording positions
+    using TurnCallback = std::function<void(const VersusGame& game)>;
+
+    struct Stats {
+        size_t games = 0;
+        size_t turns = 0;
+        size_t moves = 0;
+        size_t p1_wins = 0;
+        size_t p2_wins = 0;
+        size_t draws = 0;
+        // hit the turn limit before anyone died
+        size_t unfinished = 0;
+        // only counted when a movegen cache is set
+        MovegenCache::Counters cache;
+
+        void merge(const Stats& other) {
+            games += other.games;
+            turns += other.turns;
+            moves += other.moves;
+            p1_wins += other.p1_wins;
+            p2_wins += other.p2_wins;
+            draws += other.draws;
+            unfinished += other.unfinished;
+            cache.merge(other.cache);
+        }
+    };
+
+    static Policy random_policy() {
+        return [](const Game&, std::span<const Piece> placements, RNG& rng) -> std::optional<Piece> {
+            return placements[rng.GetRand(placements.size())];
+        };
+    }
+
+    // takes the placement that clears the most lines, then the one that leaves the lowest stack
+    static Policy greedy_lines_policy() {
+        return [](const Game& game, std::span<const Piece> placements, RNG&) -> std::optional<Piece> {
+            const Piece* best = nullptr;
+            int best_score = INT32_MIN;
+            for (const Piece& piece : placements) {
+                Board board = game.board;
+                board.set(piece);
+                const int lines = board.clearLines();
+
+                uint32_t filled = 0;
+                for (uint32_t column : board.board)
+                    filled |= column;
+                const int stack_height = 32 - std::countl_zero(filled);
+
+                const int score = lines * 64 - stack_height;
+                if (score > best_score) {
+                    best_score = score;
+                    best = &piece;
+                }
+            }
+            return *best;
+        };
+    }
+
+    static std::optional<Policy> policy_by_name(const std::string& name) {
+        if (name == "random")
+            return random_policy();
+        if (name == "greedy")
+            return greedy_lines_policy();
+        return std::nullopt;
+    }
+
+    // games that last longer than this are stopped and counted as unfinished
+    int max_turns = 1000;
+
+    // when set, placements come from this cache, it can be shared by every thread playing
+    MovegenCache* movegen_cache = nullptr;
+
+    Stats play(size_t games, const Policy& p1, const Policy& p2, u32 seed, const TurnCallback& on_turn = nullptr) const {
+        Stats stats;
+
+        RNG rng;
+        rng.rng = seed;
+
+        Game::PlacementBuffer placements;
+
+        for (size_t g = 0; g < games; g++) {
+            const u32 p1_seed = rng.GetRand(0) << 16 | rng.GetRand(0);
+            const u32 p2_seed = rng.GetRand(0) << 16 | rng.GetRand(0);
+            VersusGame game(p1_seed, p2_seed);
+
+            bool stuck = false;
+            while (!game.game_over && game.turn < max_turns) {
+                int moved = 0;
+                for (int id = 0; id < 2; id++) {
+                    const Game& player = game.get_game(id);
+
+                    placements.clear();
+                    movegen(player, player.current_piece.type, placements, stats);
+
+                    PieceType hold = player.hold.has_value() ? player.hold->type : player.queue.front();
+                    if (hold != PieceType::Empty)
+                        movegen(player, hold, placements, stats);
+
+                    std::optional<Piece> choice;
+                    if (!placements.empty())
+                        choice = (id == 0 ? p1 : p2)(player, std::span<const Piece>(placements.begin(), placements.end()), rng);
+
+                    game.set_move(id, Move(choice));
+                    moved += choice.has_value();
+                }
+
+                // play_moves turns two null moves into real ones, neither player has anywhere to go
+                if (moved == 0) {
+                    stuck = true;
+                    break;
+                }
+
+                game.play_moves();
+                stats.turns++;
+                stats.moves += moved;
+
+                if (on_turn)
+                    on_turn(game);
+            }
+
+            stats.games++;
+            if (stuck || game.state == VersusGame::State::DRAW)
+                stats.draws++;
+            else if (game.state == VersusGame::State::P1_WIN)
+                stats.p1_wins++;
+            else if (game.state == VersusGame::State::P2_WIN)
+                stats.p2_wins++;
+            else
+                stats.unfinished++;
+        }
+
+        return stats;
+    }
+
+private:
+    void movegen(const Game& game, PieceType piece_type, Game::PlacementBuffer& placements, Stats& stats) const {
+        if (movegen_cache)
+            movegen_cache->movegen(game, piece_type, placements, &stats.cache);
+        else
+            game.movegen(piece_type, placements);
+    }
+};
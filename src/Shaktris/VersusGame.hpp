@@ -10,8 +10,11 @@
 
 class VersusGame {
    public:
-    VersusGame() {
-        p1_rng.rng = std::random_device()();
+    VersusGame() : VersusGame(std::random_device()(), std::random_device()()) {}
+
+    // the whole game is decided by the seeds and the moves played
+    VersusGame(u32 p1_seed, u32 p2_seed) {
+        p1_rng.rng = p1_seed;
         p1_rng.makebag();
 
         p1_game.current_piece = p1_rng.GetPiece();
@@ -19,7 +22,7 @@ class VersusGame {
             p = p1_rng.GetPiece();
         }
 
-        p2_rng.rng = std::random_device()();
+        p2_rng.rng = p2_seed;
         p2_rng.makebag();
 
         p2_game.current_piece = p2_rng.GetPiece();
@@ -234,22 +237,17 @@ class VersusGame {
 
         const Game& player = id == 0 ? p1_game : p2_game;
 
-        std::vector<Piece> movegen_pieces = player.movegen(player.current_piece.type);
+        Game::PlacementBuffer placements;
+        player.movegen(player.current_piece.type, placements);
 
         PieceType hold = player.hold.has_value() ? player.hold.value().type : player.queue.front();
 
-        std::vector<Piece> hold_pieces;
         if (hold != PieceType::Empty)
-            hold_pieces = player.movegen(hold);
-
-        moves.reserve((movegen_pieces.size() + hold_pieces.size()) * 2);
+            player.movegen(hold, placements);
 
-        for (auto& piece : movegen_pieces) {
-            moves.emplace_back(piece, false);
-            moves.emplace_back(piece, true);
-        }
+        moves.reserve(placements.size() * 2);
 
-        for (auto& piece : hold_pieces) {
+        for (auto& piece : placements) {
             moves.emplace_back(piece, false);
             moves.emplace_back(piece, true);
         }
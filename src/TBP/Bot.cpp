@@ -1,19 +1,78 @@
 
 #include "Bot.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+
+// milliseconds left until the deadline, rounded up so a wait never ends early
+static int wait_timeout(Bot::Clock::time_point deadline) {
+    if (deadline == Bot::no_deadline)
+        return -1;
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - Bot::Clock::now());
+    return (int)std::clamp<std::chrono::milliseconds::rep>(left.count(), 0, INT32_MAX);
+}
+
+// a bot gets a moment to exit after the quit and its closed stdin, one that is still running after that is killed
+static void reap_child(pid_t pid) {
+    constexpr auto grace_period = std::chrono::milliseconds(500);
+    const auto give_up = Bot::Clock::now() + grace_period;
+    while (Bot::Clock::now() < give_up) {
+        pid_t result = waitpid(pid, nullptr, WNOHANG);
+        if (result == pid || (result == -1 && errno != EINTR))
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    kill(pid, SIGKILL);
+    while (waitpid(pid, nullptr, 0) == -1 && errno == EINTR) {
+    }
+}
+#endif
 
 bool Bot::is_running() const {
     return running;
 }
 
+bool Bot::is_plugin() const {
+    return plugin != nullptr;
+}
+
+Bot::Clock::time_point Bot::get_suggest_sent() const {
+    return suggest_sent;
+}
+
 void Bot::start(const char* path) {
+    read_buffer.clear();
+    unanswered_suggests = 0;
+    suggestion_status = BotStatus::Ok;
+    disconnected = false;
+    plugin.reset();
+
+    if (BotPlugin::is_plugin_path(path)) {
+        plugin = std::make_unique<BotPlugin>(path);
+        name = plugin->get_info().name;
+        author = plugin->get_info().author;
+        version = plugin->get_info().version;
+        std::cout << "plugin ready: " << name << " " << version << " by " << author << std::endl
+            << std::endl;
+        running = true;
+        return;
+    }
+
 #ifdef __linux__
-    if (pipe(parent_to_child) == -1 || pipe(child_to_parent) == -1) {
+    // close on exec so bots started later dont inherit the pipes of this one
+    if (pipe2(parent_to_child, O_CLOEXEC) == -1 || pipe2(child_to_parent, O_CLOEXEC) == -1) {
         perror("pipe");
         exit(1);
     }
@@ -38,16 +97,15 @@ void Bot::start(const char* path) {
     }
     else {
         // parent
+        child_pid = pid;
         close(parent_to_child[0]);
         close(child_to_parent[1]);
 
-        to_child = fdopen(parent_to_child[1], "w");
-        from_child = fdopen(child_to_parent[0], "r");
+        to_child = parent_to_child[1];
+        from_child = child_to_parent[0];
 
-        if (to_child == NULL || from_child == NULL) {
-            perror("fdopen");
-            exit(1);
-        }
+        // reads never block, receive polls with the deadline instead
+        fcntl(from_child, F_SETFL, fcntl(from_child, F_GETFL) | O_NONBLOCK);
     }
 #elif _WIN32
     SECURITY_ATTRIBUTES saAttr{};
@@ -90,70 +148,179 @@ void Bot::start(const char* path) {
 
 #endif
 
-    auto info = TBP_info();
+    TBP_info();
 
-    author = info["author"].get<std::string>();
-    name = info["name"].get<std::string>();
-    version = info["version"].get<std::string>();
-    nlohmann::json rules;
-    rules["type"] = "rules";
-    send(rules.dump());
-    auto ready = receive();
+    send(writer.rules());
+    std::string ready;
+    if (receive(ready, Clock::now() + startup_timeout) != BotStatus::Ok)
+        throw std::runtime_error("bot did not send ready: " + std::string(path));
     std::cout << "TBP ready: " << ready << std::endl
 		<< std::endl;
+    TBPReader::ready(ready);
 
     running = true;
 }
 
-void Bot::send(std::string message) {
+void Bot::send(std::string_view text) {
+    // the newline goes on in a reused buffer so the message is still one write
+    message.assign(text);
+    message += '\n';
 #ifdef __linux__
-    fprintf(to_child, "%s\n", message.c_str());
-    fflush(to_child);
+    size_t written = 0;
+    while (written < message.size()) {
+        ssize_t count = write(to_child, message.data() + written, message.size() - written);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            disconnected = true;
+            running = false;
+            return;
+        }
+        written += count;
+    }
 #elif _WIN32
     DWORD dwWritten;
-    std::string chBuf = message + "\n";
     BOOL bSuccess = FALSE;
 
-    bSuccess = WriteFile(g_hChildStd_IN_Wr, (LPVOID*)chBuf.c_str(),
-        chBuf.size(), &dwWritten, NULL);
+    bSuccess = WriteFile(g_hChildStd_IN_Wr, (LPVOID*)message.c_str(),
+        message.size(), &dwWritten, NULL);
     if (!bSuccess) return;
 #endif
 }
 
-std::string Bot::receive() {
+bool Bot::has_line() const {
+    return read_buffer.find('\n') != std::string::npos;
+}
+
+BotStatus Bot::read_available() {
 #ifdef __linux__
-    using Ch = char;
-#else // _WIN32
-    using Ch = CHAR;
+    char chunk[4096];
+    while (true) {
+        ssize_t count = read(from_child, chunk, sizeof(chunk));
+        if (count > 0) {
+            if (std::memchr(chunk, '\n', count))
+                line_arrived = Clock::now();
+            read_buffer.append(chunk, count);
+            continue;
+        }
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return BotStatus::Ok;
+        // end of file or a broken pipe
+        return BotStatus::Disconnected;
+    }
+#elif _WIN32
+    // blocks until the bot writes something
+    CHAR chunk[4096];
+    DWORD dwRead;
+    if (!ReadFile(g_hChildStd_OUT_Rd, chunk, sizeof(chunk), &dwRead, NULL) || dwRead == 0)
+        return BotStatus::Disconnected;
+    if (std::memchr(chunk, '\n', dwRead))
+        line_arrived = Clock::now();
+    read_buffer.append(chunk, dwRead);
+    return BotStatus::Ok;
 #endif
+}
 
-    Ch buffer[4096]{};
-
-    std::string message;
+BotStatus Bot::receive(std::string& line, Clock::time_point deadline) {
+    size_t end;
+    while ((end = read_buffer.find('\n')) == std::string::npos) {
+        if (disconnected)
+            return BotStatus::Disconnected;
 
 #ifdef __linux__
-    fgets(buffer, sizeof(buffer), from_child);
-    message = buffer;
-#elif _WIN32
-    DWORD dwRead;
-    BOOL bSuccess = FALSE;
+        // the same wait as a whole turn, a bot that went away comes back disconnected
+        Bot* self = this;
+        wait_for_lines(std::span(&self, 1), deadline);
+        if (!disconnected && !has_line())
+            return BotStatus::Timeout;
+#else
+        if (read_available() != BotStatus::Ok) {
+            // whatever came in before the end can still be handed out
+            disconnected = true;
+            running = false;
+        }
+#endif
+    }
 
-    bSuccess = ReadFile(g_hChildStd_OUT_Rd, buffer,
-        4096, &dwRead, NULL);
-    if (!bSuccess || dwRead == 0) return "";
+    line.assign(read_buffer, 0, end);
+    read_buffer.erase(0, end + 1);
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+    return BotStatus::Ok;
+}
 
-    message.append(buffer, dwRead);
+void Bot::wait_for_lines(std::span<Bot* const> bots, Clock::time_point deadline) {
+#ifdef __linux__
+    // polls the pipes the bots already have so nothing is set up or torn down per turn
+    // the bots still waiting are kept between calls so a turn doesnt allocate either
+    thread_local std::vector<pollfd> fds;
+    thread_local std::vector<Bot*> waiting;
+    fds.clear();
+    waiting.clear();
+
+    for (Bot* bot : bots) {
+        // a plugin answered when it was asked
+        if (bot->plugin || bot->disconnected || bot->has_line())
+            continue;
+        fds.push_back({ bot->from_child, POLLIN, 0 });
+        waiting.push_back(bot);
+    }
 
-#endif
+    while (!fds.empty()) {
+        int ready = poll(fds.data(), fds.size(), wait_timeout(deadline));
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            break;
 
-    return message;
+        for (size_t i = 0; i < fds.size();) {
+            if (fds[i].revents == 0) {
+                i++;
+                continue;
+            }
+            Bot& bot = *waiting[i];
+            if (bot.read_available() != BotStatus::Ok) {
+                bot.disconnected = true;
+                bot.running = false;
+            }
+            if (!bot.disconnected && !bot.has_line()) {
+                i++;
+                continue;
+            }
+            // done with this bot, the last one takes its place and is looked at next
+            fds[i] = fds.back();
+            fds.pop_back();
+            waiting[i] = waiting.back();
+            waiting.pop_back();
+        }
+    }
+#endif
 }
 
 void Bot::stop() {
+    // nothing owed by the stopped bot carries over to a restart
+    unanswered_suggests = 0;
+    suggestion_status = BotStatus::Ok;
+    read_buffer.clear();
+    if (plugin) {
+        plugin.reset();
+        running = false;
+        return;
+    }
     TBP_quit();
+    running = false;
 #ifdef __linux__
-    fclose(to_child);
-    fclose(from_child);
+    close(to_child);
+    close(from_child);
+    to_child = from_child = -1;
+
+    // the bot is waited on so restarted bots dont pile up as zombies
+    if (child_pid > 0) {
+        reap_child(child_pid);
+        child_pid = -1;
+    }
 #elif _WIN32
     CloseHandle(g_hChildStd_IN_Wr);
     CloseHandle(g_hChildStd_OUT_Rd);
@@ -172,165 +339,59 @@ const std::string& Bot::get_version() const {
     return version;
 }
 
+const LatencyHistogram& Bot::get_game_latency() const {
+    return game_latency;
+}
+
+void Bot::reset_game_latency() {
+    game_latency.clear();
+}
+
 void Bot::TBP_play(const Game& opp, const Piece& piece) {
-    nlohmann::json play;
-    auto px = piece.position.x;
-    auto py = piece.position.y;
-    auto pk = piece.type;
-    play["type"] = "play";
-
-    play["move"]["location"]["type"] = [](PieceType type) -> std::string {
-        switch (type) {
-        case PieceType::S:
-            return "S";
-            break;
-        case PieceType::Z:
-            return "Z";
-            break;
-        case PieceType::J:
-            return "J";
-            break;
-        case PieceType::L:
-            return "L";
-            break;
-        case PieceType::T:
-            return "T";
-            break;
-        case PieceType::O:
-            return "O";
-            break;
-        case PieceType::I:
-            return "I";
-            break;
-        default:
-            throw std::runtime_error("invalid piece");
-            break;
-        }
-        }(piece.type);
-    play["move"]["location"]["orientation"] = [](RotationDirection dir) -> std::string {
-        switch (dir) {
-        case North:
-            return "north";
-            break;
-        case East:
-            return "east";
-            break;
-        case South:
-            return "south";
-            break;
-        case West:
-            return "west";
-            break;
-        default:
-            throw std::runtime_error("invalid direction");
-            break;
-        }
-        }(piece.rotation);
-    play["move"]["location"]["x"] = piece.position.x;
-    play["move"]["location"]["y"] = piece.position.y;
-
-    play["move"]["spin"] = [](spinType s) -> std::string {
-        switch (s) {
-        case spinType::null:
-            return "none";
-            break;
-        case spinType::mini:
-            return "mini";
-            break;
-        case spinType::normal:
-            return "full";
-            break;
-        default:
-            throw std::runtime_error("invalid spin");
-            break;
-        }
-        }(piece.spin);
-
-
-    play["opponents"] = nlohmann::json::array();
-    // hard code only one player
-
-    nlohmann::json tmp_board = nlohmann::json::array();
-
-    for (int y = 0; y < Board::height; ++y) {
-		nlohmann::json tmp = nlohmann::json::array();
-		for (int x = 0; x < Board::width; ++x) {
-			if (opp.board.get(x, y))
-				tmp.push_back("G");
-			else
-				tmp.push_back(nullptr);
-		}
-        tmp_board.push_back(tmp);
-	}
-
-    play["opponents"][0]["board"] = tmp_board;
-
-
-    play["opponents"][0]["combo"] = opp.stats.combo;
-    play["opponents"][0]["back_to_back"] = opp.stats.b2b;
-    play["opponents"][0]["meter"] = opp.garbage_meter;
-
-    play["opponents"][0]["queue"] = nlohmann::json::array();
-
-    auto piece_type_to_str = [](PieceType type) -> std::string {
-		switch (type) {
-		case PieceType::S:
-			return "S";
-			break;
-		case PieceType::Z:
-			return "Z";
-			break;
-		case PieceType::J:
-			return "J";
-			break;
-		case PieceType::L:
-			return "L";
-			break;
-		case PieceType::T:
-			return "T";
-			break;
-		case PieceType::O:
-			return "O";
-			break;
-		case PieceType::I:
-			return "I";
-			break;
-		default:
-			break;
-		}
-        return "";
-	};
-
-    play["opponents"][0]["queue"].push_back(piece_type_to_str(opp.current_piece.type));
-
-    for (const auto& piece : opp.queue) {
-		play["opponents"][0]["queue"].push_back(piece_type_to_str(piece));
-	}
-
-    send(play.dump());
+    if (plugin) {
+        plugin->play(opp, piece);
+        return;
+    }
+
+    const std::string_view play = writer.play(opp, piece);
+    send(play);
     std::cout << "TBP play: " << play << std::endl
         << std::endl;
 }
 
-nlohmann::json Bot::TBP_info() {
-    nlohmann::json uselessInfo;
-    uselessInfo = nlohmann::json::parse(receive());
+TBPInfo Bot::TBP_info() {
+    std::string line;
+    if (receive(line, Clock::now() + startup_timeout) != BotStatus::Ok)
+        throw std::runtime_error("bot did not send info");
+    std::cout << "TBP info: " << line << std::endl
+        << std::endl;
     // cold clear is supposed to be sending this first
     // {"type":"info","name":"Cold Clear","version":"2020-05-05","author":"MinusKelvin","features":[]}
+    TBPInfo info = TBPReader::info(line);
 
-    name = uselessInfo["name"];
-    author = uselessInfo["author"];
-    version = uselessInfo["version"];
-    std::cout << "TBP info: " << uselessInfo << std::endl
-        << std::endl;
-    return uselessInfo;
+    name = info.name;
+    author = info.author;
+    version = info.version;
+    return info;
 }
 
 void Bot::TBP_suggest() {
-    nlohmann::json suggest;
-    suggest["type"] = "suggest";
+    if (plugin) {
+        // the plugin thinks in this call, its answer is timed and kept for TBP_suggestion
+        suggest_sent = Clock::now();
+        plugin_status = plugin->suggest(plugin_moves);
+        line_arrived = Clock::now();
+        if (plugin_status == BotStatus::Disconnected) {
+            disconnected = true;
+            running = false;
+        }
+        return;
+    }
 
-    send(suggest.dump());
+    unanswered_suggests++;
+    suggest_sent = Clock::now();
+    const std::string_view suggest = writer.suggest();
+    send(suggest);
     std::cout << "TBP suggest: " << suggest << std::endl
         << std::endl;
 }
@@ -343,257 +404,108 @@ void Bot::TBP_suggest() {
 */
 
 std::vector<Piece> Bot::TBP_suggestion() {
-    nlohmann::json suggestion;
-    std::cout << "TBP suggestion: ";
-    // example: {"moves":[{"location":{"orientation":"north","type":"L","x":8,"y":0},"spin":"none"}],"type":"suggestion"}
-    std::string suggestion_str = receive();
-    std::cout << suggestion_str << std::endl << std::endl;
-    suggestion = nlohmann::json::parse(suggestion_str);
     std::vector<Piece> moves;
-    for (const auto& move : suggestion["moves"]) {
-        PieceType type;
-        RotationDirection orientation;
-        int x;
-        int y;
-        spinType spin;
-        type = [](std::string type) -> PieceType {
-            if (type == "S")
-                return PieceType::S;
-            else if (type == "Z")
-                return PieceType::Z;
-            else if (type == "J")
-                return PieceType::J;
-            else if (type == "L")
-                return PieceType::L;
-            else if (type == "T")
-                return PieceType::T;
-            else if (type == "O")
-                return PieceType::O;
-            else if (type == "I")
-                return PieceType::I;
-            throw std::runtime_error("invalid piece");
-            }(move["location"]["type"]);
-
-        orientation = [](std::string orientation) -> RotationDirection {
-                if (orientation == "north")
-                    return North;
-                else if (orientation == "east")
-                    return East;
-                else if (orientation == "south")
-                    return South;
-                else if (orientation == "west")
-                    return West;
-                throw std::runtime_error("invalid orientation");
-                }(move["location"]["orientation"]);
-
-        x = move["location"]["x"].get<int>();
-        y = move["location"]["y"].get<int>();
-
-        spin = [](std::string spin) -> spinType {
-                    if (spin == "none")
-                        return spinType::null;
-                    else if (spin == "mini")
-                        return spinType::mini;
-                    else if (spin == "full")
-                        return spinType::normal;
-                    throw std::runtime_error("invalid spin");
-        }(move["spin"]);
-        Piece piece = type;
-        piece.position = Coord(x, y);
-        piece.spin = spin;
-
-        for (int i = 0; i < orientation; ++i)
-		    piece.rotate(TurnDirection::Right);
-        moves.push_back(piece);
-    }
+    const BotStatus status = TBP_suggestion(moves, no_deadline);
+    if (status != BotStatus::Ok)
+        throw std::runtime_error("bot " + std::string(describe(status)) + " while suggesting: " + name);
     return moves;
 }
 
-void Bot::TBP_start(const Game& opp, const Board& board, const std::vector<PieceType> &queue, std::optional<Piece> hold, bool back_to_back, int combo) {
-    nlohmann::json start;
-    start["type"] = "start";
-
-    if (hold.has_value()) {
-        start["hold"] = [](PieceType type) -> nlohmann::json {
-            switch (type) {
-            case PieceType::S:
-                return "S";
-                break;
-            case PieceType::Z:
-                return "Z";
-                break;
-            case PieceType::J:
-                return "J";
-                break;
-            case PieceType::L:
-                return "L";
-                break;
-            case PieceType::T:
-                return "T";
-                break;
-            case PieceType::O:
-                return "O";
-                break;
-            case PieceType::I:
-                return "I";
-                break;
-            case PieceType::Empty:
-                return "I";
-                break;
-            default:
-                return nullptr;
-                break;
-            }
-            }(hold.value().type);
-    }
-    else
-        start["hold"] = nullptr;
+BotStatus Bot::TBP_suggestion(std::vector<Piece>& moves, Clock::duration timeout) {
+    return TBP_suggestion(moves, suggest_sent + timeout);
+}
 
-    std::vector<std::string> tbpQueue;
+BotStatus Bot::TBP_suggestion(std::vector<Piece>& moves, Clock::time_point deadline) {
+    suggestion_status = read_suggestion(moves, deadline);
+    return suggestion_status;
+}
 
-    for (const auto& piece : queue) {
-        switch (piece) {
-        case PieceType::S:
-            tbpQueue.push_back("S");
-            break;
-        case PieceType::Z:
-            tbpQueue.push_back("Z");
-            break;
-        case PieceType::I:
-            tbpQueue.push_back("I");
-            break;
-        case PieceType::T:
-            tbpQueue.push_back("T");
-            break;
-        case PieceType::O:
-            tbpQueue.push_back("O");
-            break;
-        case PieceType::J:
-            tbpQueue.push_back("J");
-            break;
-        case PieceType::L:
-            tbpQueue.push_back("L");
-            break;
-        default:
-            throw std::runtime_error("invalid piece");
-            break;
-        }
-    }
+BotStatus Bot::get_suggestion_status() const {
+    return suggestion_status;
+}
 
-    start["queue"] = tbpQueue;
-    start["combo"] = combo;
-    start["back_to_back"] = back_to_back;
+BotStatus Bot::read_suggestion(std::vector<Piece>& moves, Clock::time_point deadline) {
+    if (plugin) {
+        if (plugin_status != BotStatus::Ok)
+            return plugin_status;
+        // a plugin cant be interrupted, one that took too long still forfeits like a TBP bot would
+        if (line_arrived > deadline)
+            return BotStatus::Timeout;
+        game_latency.record(line_arrived - suggest_sent);
+        moves = std::move(plugin_moves);
+        plugin_moves.clear();
+        return BotStatus::Ok;
+    }
 
-    std::array<std::array<std::optional<std::string>, 40>, 10> tbpBoard;
+    // answers to suggests that timed out come in first, they are for positions that are gone
+    do {
+        BotStatus status = receive(suggestion_line, deadline);
+        if (status != BotStatus::Ok)
+            return status;
+        unanswered_suggests--;
+    } while (unanswered_suggests > 0);
 
-    for (int x = 0; x < Board::width; ++x)
-        for (int y = 0; y < Board::visual_height; ++y) {
-            if (board.get(x, y))
-                tbpBoard[x][y] = "G";
-            else
-                tbpBoard[x][y] = std::nullopt;
-        }
+    // the line may have been read while waiting on a bot with a later deadline
+    if (line_arrived > deadline)
+        return BotStatus::Timeout;
 
-    start["board"] = nlohmann::json::array();
+    game_latency.record(line_arrived - suggest_sent);
 
-    for (int y = 0; y < Board::height; ++y) {
-        nlohmann::json tmp = nlohmann::json::array();
-        for (int x = 0; x < Board::width; ++x) {
-            if (tbpBoard[x][y].has_value()) {
-                tmp.push_back(tbpBoard[x][y].value());
-            }
-            else {
-                tmp.push_back(nullptr);
-            }
-        }
-        start["board"].push_back(tmp);
+    std::cout << "TBP suggestion: ";
+    // example: {"moves":[{"location":{"orientation":"north","type":"L","x":8,"y":0},"spin":"none"}],"type":"suggestion"}
+    std::cout << suggestion_line << std::endl << std::endl;
+    try {
+        TBPReader::suggestion(suggestion_line, moves);
+    } catch (const std::exception& e) {
+        std::cerr << name << ": " << e.what() << std::endl;
+        moves.clear();
+        return BotStatus::Invalid;
     }
+    return BotStatus::Ok;
+}
 
-    for (int y = Board::height; y < 40; ++y) {
-        nlohmann::json tmp = nlohmann::json::array();
-        for (int x = 0; x < Board::width; ++x) {
-            tmp.push_back(nullptr);
-        }
-        start["board"].push_back(tmp);
+void Bot::TBP_start(const Game& opp, const Board& board, const std::vector<PieceType> &queue, std::optional<Piece> hold, bool back_to_back, int combo) {
+    if (plugin) {
+        plugin->start(opp, board, queue, hold, back_to_back, combo);
+        return;
     }
 
-    start["opponents"] = nlohmann::json::array();
-
-    nlohmann::json tmp_board = nlohmann::json::array();
-
-    for (int y = 0; y < Board::height; ++y) {
-		nlohmann::json tmp = nlohmann::json::array();
-		for (int x = 0; x < Board::width; ++x) {
-			if (opp.board.get(x, y))
-				tmp.push_back("G");
-			else
-				tmp.push_back(nullptr);
-		}
-		tmp_board.push_back(tmp);
-	}
-
-    start["opponents"][0]["board"] = tmp_board;
-
+    const std::string_view start = writer.start(opp, board, queue, hold, back_to_back, combo);
     std::cout << "TBP start: " << start << std::endl
         << std::endl;
 
-    send(start.dump());
+    send(start);
 }
 
 void Bot::TBP_new_piece(PieceType t) {
-    nlohmann::json new_piece;
-    new_piece["type"] = "new_piece";
-
-    new_piece["piece"] = [](PieceType t) -> std::string {
-        switch (t) {
-        case PieceType::S:
-            return ("S");
-            break;
-        case PieceType::Z:
-            return ("Z");
-            break;
-        case PieceType::I:
-            return ("I");
-            break;
-        case PieceType::T:
-            return ("T");
-            break;
-        case PieceType::O:
-            return ("O");
-            break;
-        case PieceType::J:
-            return ("J");
-            break;
-        case PieceType::L:
-            return ("L");
-            break;
-        default:
-            return ("Error");
-            break;
-        }
-        }(t);
+    if (plugin) {
+        plugin->new_piece(t);
+        return;
+    }
 
+    const std::string_view new_piece = writer.new_piece(t);
     std::cout << "TBP new piece: " << new_piece << std::endl
         << std::endl;
-    send(new_piece.dump());
+    send(new_piece);
 }
 
 // stops the game itself, a new game CAN be started by sending a start command
 void Bot::TBP_stop() {
-    nlohmann::json stop;
-    stop["type"] = "stop";
+    if (plugin) {
+        plugin->stop();
+        return;
+    }
 
+    const std::string_view stop = writer.stop();
     std::cout << "TBP stop: " << stop << std::endl
         << std::endl;
-    send(stop.dump());
+    send(stop);
 }
 
 // if this is sent, the game will end and the bot will be disconnected
 void Bot::TBP_quit() {
-    nlohmann::json quit;
-    quit["type"] = "quit";
-
+    const std::string_view quit = writer.quit();
     std::cout << "TBP quit: " << quit << std::endl
         << std::endl;
-    send(quit.dump());
+    send(quit);
 }
@@ -1,12 +1,22 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
 #include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "Board.hpp"
+#include "BotPlugin.hpp"
+#include "BotStatus.hpp"
 #include "Game.hpp"
 #include "Piece.hpp"
+#include "TBPReader.hpp"
+#include "TBPWriter.hpp"
 #include "json.hpp"
+#include "latency_histogram.hpp"
 
 #ifdef __linux__
 #include <sys/types.h>
@@ -20,9 +30,20 @@
 
 class Bot {
 public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr Clock::time_point no_deadline = Clock::time_point::max();
+
+    // how long start waits for the info and ready messages
+    static constexpr std::chrono::seconds startup_timeout{ 10 };
 
     bool is_running() const;
+
+    bool is_plugin() const;
     
+    // a path ending in .so, .dylib or .dll is loaded as a BotPlugin, anything else is run as a TBP process
+    // the TBP_ calls work the same for both
+    // a TBP bot that died kills the program on the next write unless the program ignores SIGPIPE
     void start(const char* path);
     void stop();
     const std::string& get_name() const;
@@ -31,12 +52,25 @@ public:
 
     void TBP_play(const Game &opp, const Piece& move);
 
-    nlohmann::json TBP_info();
+    TBPInfo TBP_info();
 
     void TBP_suggest();
 
+    // blocks until the bot answers, throws if it disconnects or the answer is invalid
     std::vector<Piece> TBP_suggestion();
 
+    // suggestions that come in after a timeout are skipped by the next call
+    BotStatus TBP_suggestion(std::vector<Piece>& moves, Clock::time_point deadline);
+
+    // the timeout counts from this bot's own suggest, time spent on other bots before it doesnt count against it
+    BotStatus TBP_suggestion(std::vector<Piece>& moves, Clock::duration timeout);
+
+    // when the last suggest was sent, for a plugin when it started thinking
+    Clock::time_point get_suggest_sent() const;
+
+    // how the last TBP_suggestion ended, a bot that timed out or answered something invalid shouldnt be reused
+    BotStatus get_suggestion_status() const;
+
     void TBP_start(const Game& opp, const Board& board, const std::vector<PieceType>& queue, std::optional<Piece> hold = std::nullopt, bool back_to_back = false, int combo = 0);
 
     void TBP_new_piece(PieceType t);
@@ -44,20 +78,61 @@ public:
     // stops the game itself, a new game CAN be started by sending a start command
     void TBP_stop();
 
+    // reads from every bot until each has a whole message waiting or the deadline passes
+    // lets one thread wait on many bots, the receives after it dont block
+    // deadlines are only supported on linux, elsewhere this does nothing and receives block
+    static void wait_for_lines(std::span<Bot* const> bots, Clock::time_point deadline);
+
+    // suggest to suggestion round trips, timed from sending the suggest to the answer arriving
+    // only covers the current game, pooled bots get replaced so totals are merged by whoever runs the games
+    const LatencyHistogram& get_game_latency() const;
+
+    // starts a new game latency histogram
+    void reset_game_latency();
+
 private:
     // if this is sent, the game will end and the bot will be disconnected
     void TBP_quit();
 
 private:
-    void send(std::string message);
-    std::string receive();
+    void send(std::string_view text);
+    // takes the next line without its newline
+    BotStatus receive(std::string& line, Clock::time_point deadline);
+
+    // TBP_suggestion without remembering how it ended
+    BotStatus read_suggestion(std::vector<Piece>& moves, Clock::time_point deadline);
+
+    bool has_line() const;
+
+    // moves everything the pipe has into read_buffer without blocking
+    BotStatus read_available();
+
+    TBPWriter writer;
+    // the last suggestion line, kept so reading the next one reuses its memory
+    std::string suggestion_line;
+    // the message being sent with its newline
+    std::string message;
+
+    // bytes read but not returned yet, a message can be any length and arrive in pieces
+    std::string read_buffer;
+    // suggests sent that were not answered yet
+    int unanswered_suggests = 0;
+    BotStatus suggestion_status = BotStatus::Ok;
+    bool disconnected = false;
+
+    Clock::time_point suggest_sent;
+    // when the newest whole line came in, reading it out of the buffer can happen a lot later
+    Clock::time_point line_arrived;
+    LatencyHistogram game_latency;
 
 #ifdef __linux__
     int parent_to_child[2]{};
     int child_to_parent[2]{};
 
-    FILE* to_child{};
-    FILE* from_child{};
+    int to_child = -1;
+    int from_child = -1;
+    // waited on in stop
+    pid_t child_pid = -1;
 #elif _WIN32
     HANDLE g_hChildStd_IN_Rd = NULL;
     HANDLE g_hChildStd_IN_Wr = NULL;
@@ -66,6 +141,12 @@ private:
 #endif
 
 
+    // set while the bot is a plugin, the pipes are unused then
+    std::unique_ptr<BotPlugin> plugin;
+    // a plugin answers in TBP_suggest, the answer waits here for TBP_suggestion
+    std::vector<Piece> plugin_moves;
+    BotStatus plugin_status = BotStatus::Ok;
+
     std::string name;
     std::string author;
     std::string version;
@@ -0,0 +1,171 @@
+#include "BotPlugin.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Dataset/GameState.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#undef min
+#undef max
+#else
+#include <dlfcn.h>
+#endif
+
+static_assert(u8(PieceType::S) == UTS_PIECE_S && u8(PieceType::I) == UTS_PIECE_I && u8(PieceType::Empty) == UTS_PIECE_NONE,
+              "piece types are passed to plugins as they are");
+static_assert(Board::width == UTS_BOARD_WIDTH && Board::height == UTS_BOARD_HEIGHT, "boards are passed to plugins column by column");
+static_assert(Game::queue_size + 1 <= UTS_QUEUE_CAPACITY, "the queue and the current piece have to fit the plugin queue");
+
+static void* load_library(const std::string& path) {
+#ifdef _WIN32
+    return (void*)LoadLibraryA(path.c_str());
+#else
+    // a bare file name would be looked up on the library path instead of next to the stadium
+    const std::string local = path.find('/') == std::string::npos ? "./" + path : path;
+    return dlopen(local.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+static void* find_symbol(void* library, const char* name) {
+#ifdef _WIN32
+    return (void*)GetProcAddress((HMODULE)library, name);
+#else
+    return dlsym(library, name);
+#endif
+}
+
+static void close_library(void* library) {
+#ifdef _WIN32
+    FreeLibrary((HMODULE)library);
+#else
+    dlclose(library);
+#endif
+}
+
+static std::string library_error() {
+#ifdef _WIN32
+    return "error " + std::to_string(GetLastError());
+#else
+    const char* error = dlerror();
+    return error ? error : "unknown error";
+#endif
+}
+
+bool BotPlugin::is_plugin_path(const std::string& path) {
+    for (const char* extension : { ".so", ".dylib", ".dll" }) {
+        const std::string ext = extension;
+        if (path.size() > ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0)
+            return true;
+    }
+    return false;
+}
+
+BotPlugin::BotPlugin(const std::string& path) {
+    library = load_library(path);
+    if (!library)
+        throw std::runtime_error("couldnt load bot plugin " + path + ": " + library_error());
+
+    // every function is looked up before anything is called so a half built plugin fails here and not mid game
+    auto symbol = [&](const char* name) {
+        void* function = find_symbol(library, name);
+        if (!function) {
+            close_library(library);
+            throw std::runtime_error("bot plugin " + path + " doesnt export " + name);
+        }
+        return function;
+    };
+    auto abi_version_fn = (uts_bot_abi_version_fn)symbol("uts_bot_abi_version");
+    auto create_fn = (uts_bot_create_fn)symbol("uts_bot_create");
+    destroy_fn = (uts_bot_destroy_fn)symbol("uts_bot_destroy");
+    start_fn = (uts_bot_start_fn)symbol("uts_bot_start");
+    suggest_fn = (uts_bot_suggest_fn)symbol("uts_bot_suggest");
+    play_fn = (uts_bot_play_fn)symbol("uts_bot_play");
+    new_piece_fn = (uts_bot_new_piece_fn)symbol("uts_bot_new_piece");
+    stop_fn = (uts_bot_stop_fn)symbol("uts_bot_stop");
+
+    const uint32_t abi_version = abi_version_fn();
+    if (abi_version != UTS_BOT_PLUGIN_ABI_VERSION) {
+        close_library(library);
+        throw std::runtime_error("bot plugin " + path + " was built for abi version " + std::to_string(abi_version) + ", this stadium uses " +
+                                 std::to_string(UTS_BOT_PLUGIN_ABI_VERSION));
+    }
+
+    bot = create_fn(&info);
+    if (!bot) {
+        close_library(library);
+        throw std::runtime_error("bot plugin " + path + " couldnt create a bot");
+    }
+    // the bot fills fixed size buffers, a missing terminator shouldnt read past them
+    info.name[sizeof(info.name) - 1] = info.author[sizeof(info.author) - 1] = info.version[sizeof(info.version) - 1] = '\0';
+}
+
+BotPlugin::~BotPlugin() {
+    destroy_fn(bot);
+    close_library(library);
+}
+
+uts_player_state BotPlugin::player_state(const Game& game) {
+    uts_player_state state{};
+    for (size_t x = 0; x < Board::width; x++)
+        state.board[x] = game.board.get_column(x);
+    state.queue[0] = u8(game.current_piece.type);
+    for (size_t i = 0; i < Game::queue_size; i++)
+        state.queue[i + 1] = u8(game.queue[i]);
+    state.queue_length = u8(Game::queue_size + 1);
+    state.hold = game.hold ? u8(game.hold->type) : UTS_PIECE_NONE;
+    state.back_to_back = game.stats.b2b != 0;
+    state.combo = game.stats.combo;
+    state.meter = game.garbage_meter;
+    return state;
+}
+
+void BotPlugin::start(const Game& opp, const Board& board, const std::vector<PieceType>& queue, std::optional<Piece> hold, bool back_to_back, int combo) {
+    uts_player_state self{};
+    for (size_t x = 0; x < Board::width; x++)
+        self.board[x] = board.get_column(x);
+    self.queue_length = u8(std::min<size_t>(queue.size(), UTS_QUEUE_CAPACITY));
+    for (size_t i = 0; i < self.queue_length; i++)
+        self.queue[i] = u8(queue[i]);
+    self.hold = hold ? u8(hold->type) : UTS_PIECE_NONE;
+    self.back_to_back = back_to_back;
+    self.combo = combo;
+
+    const uts_player_state opponent = player_state(opp);
+    start_fn(bot, &self, &opponent);
+}
+
+BotStatus BotPlugin::suggest(std::vector<Piece>& moves) {
+    uint16_t suggested[max_suggestions];
+    const int32_t count = suggest_fn(bot, suggested, max_suggestions);
+    moves.clear();
+    if (count < 0)
+        return BotStatus::Disconnected;
+    // a count past the buffer means the bot wrote past it too
+    if (count > max_suggestions)
+        return BotStatus::Invalid;
+
+    for (int32_t i = 0; i < count; i++) {
+        const packed_move move{ suggested[i] };
+        if (move.type() >= UTS_PIECE_NONE || move.x() >= Board::width || move.spin() > u8(spinType::normal)) {
+            moves.clear();
+            return BotStatus::Invalid;
+        }
+        moves.push_back(move.piece());
+    }
+    return BotStatus::Ok;
+}
+
+void BotPlugin::play(const Game& opp, const Piece& move) {
+    const uts_player_state opponent = player_state(opp);
+    play_fn(bot, packed_move::pack(move).bits, &opponent);
+}
+
+void BotPlugin::new_piece(PieceType type) {
+    new_piece_fn(bot, u8(type));
+}
+
+void BotPlugin::stop() {
+    stop_fn(bot);
+}
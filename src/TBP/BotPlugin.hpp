@@ -0,0 +1,56 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "BotStatus.hpp"
+#include "Game.hpp"
+#include "Piece.hpp"
+#include "uts_bot_plugin.h"
+
+// a bot loaded as a shared library, see uts_bot_plugin.h
+// the same messages as TBP but as direct calls on structs, nothing is formatted, parsed or sent through a pipe
+class BotPlugin {
+public:
+    // the most moves a suggestion can hold
+    static constexpr int max_suggestions = 64;
+
+    // whether start should load path as a plugin instead of running it
+    static bool is_plugin_path(const std::string& path);
+
+    // loads the library and creates an instance, throws if either fails
+    explicit BotPlugin(const std::string& path);
+    ~BotPlugin();
+
+    BotPlugin(const BotPlugin&) = delete;
+    BotPlugin& operator=(const BotPlugin&) = delete;
+
+    const uts_bot_info& get_info() const {
+        return info;
+    }
+
+    void start(const Game& opp, const Board& board, const std::vector<PieceType>& queue, std::optional<Piece> hold, bool back_to_back, int combo);
+
+    // Disconnected if the bot failed, Invalid if it wrote more moves than it was given room for or a move that isnt one
+    // moves is left empty unless Ok
+    BotStatus suggest(std::vector<Piece>& moves);
+
+    void play(const Game& opp, const Piece& move);
+    void new_piece(PieceType type);
+    void stop();
+
+private:
+    static uts_player_state player_state(const Game& game);
+
+    void* library = nullptr;
+    void* bot = nullptr;
+    uts_bot_info info{};
+
+    uts_bot_destroy_fn destroy_fn = nullptr;
+    uts_bot_start_fn start_fn = nullptr;
+    uts_bot_suggest_fn suggest_fn = nullptr;
+    uts_bot_play_fn play_fn = nullptr;
+    uts_bot_new_piece_fn new_piece_fn = nullptr;
+    uts_bot_stop_fn stop_fn = nullptr;
+};
@@ -0,0 +1,142 @@
+#include "BotPool.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+BotPool::Lease& BotPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        if (pool && bot)
+            pool->release(index, std::move(bot));
+        pool = other.pool;
+        index = other.index;
+        bot = std::move(other.bot);
+    }
+    return *this;
+}
+
+BotPool::Lease::~Lease() {
+    if (pool && bot)
+        pool->release(index, std::move(bot));
+}
+
+BotPool::BotPool(std::vector<std::string> paths, size_t instances_per_bot) {
+    bots.resize(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        bots[i].path = std::move(paths[i]);
+        for (size_t n = 0; n < instances_per_bot; n++)
+            to_start.push_back(i);
+    }
+
+    // every instance is started at once, a bot loading its files mostly waits so this pays off even on few cores
+    const size_t starter_count = std::clamp<size_t>(to_start.size(), 1, max_parallel_starts);
+    for (size_t i = 0; i < starter_count; i++)
+        starters.emplace_back([this] { start_instances(); });
+}
+
+BotPool::~BotPool() {
+    {
+        std::lock_guard lock(mutex);
+        closing = true;
+    }
+    start_requested.notify_all();
+    instance_ready.notify_all();
+    // a start already under way is waited for
+    for (std::thread& starter : starters)
+        starter.join();
+
+    for (Instances& instances : bots)
+        for (auto& bot : instances.ready)
+            bot->stop();
+}
+
+BotPool::Lease BotPool::acquire(size_t index) {
+    std::unique_lock lock(mutex);
+    Instances& instances = bots.at(index);
+    instance_ready.wait(lock, [&] { return !instances.ready.empty() || instances.failed || closing; });
+    if (instances.ready.empty())
+        throw std::runtime_error(instances.failed ? "bot keeps failing to start: " + instances.path : "the bot pool is closing");
+
+    std::unique_ptr<Bot> bot = std::move(instances.ready.back());
+    instances.ready.pop_back();
+    return Lease(this, index, std::move(bot));
+}
+
+size_t BotPool::ready_count(size_t index) const {
+    std::lock_guard lock(mutex);
+    return bots.at(index).ready.size();
+}
+
+bool BotPool::has_failed(size_t index) const {
+    std::lock_guard lock(mutex);
+    return bots.at(index).failed;
+}
+
+void BotPool::release(size_t index, std::unique_ptr<Bot> bot) {
+    // a bot that timed out still owes an answer and would wait for it in every later game, one that answered garbage
+    // cant be trusted either, both are replaced instead of reused
+    bool reusable = bot->is_running() && bot->get_suggestion_status() == BotStatus::Ok;
+    if (reusable) {
+        bot->TBP_stop();
+        // a bot that went away while being told to stop is replaced too
+        reusable = bot->is_running();
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        if (reusable && !closing) {
+            bots[index].ready.push_back(std::move(bot));
+            instance_ready.notify_all();
+            return;
+        }
+    }
+
+    // stopping waits for the process to exit, the pool stays usable meanwhile
+    bot->stop();
+
+    std::lock_guard lock(mutex);
+    if (!closing) {
+        to_start.push_back(index);
+        start_requested.notify_one();
+    }
+}
+
+void BotPool::start_instances() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        start_requested.wait(lock, [&] { return !to_start.empty() || closing; });
+        if (closing)
+            return;
+
+        const size_t index = to_start.front();
+        to_start.pop_front();
+        if (bots[index].failed)
+            continue;
+        const std::string path = bots[index].path;
+
+        // starting takes as long as the bot needs to load, the pool stays usable meanwhile
+        lock.unlock();
+        auto bot = std::make_unique<Bot>();
+        bool started = false;
+        try {
+            bot->start(path.c_str());
+            started = true;
+        } catch (const std::exception& e) {
+            std::cerr << "couldnt start " << path << ": " << e.what() << std::endl;
+            bot->stop();
+        }
+        lock.lock();
+
+        Instances& instances = bots[index];
+        if (started) {
+            instances.consecutive_failures = 0;
+            instances.ready.push_back(std::move(bot));
+        } else if (++instances.consecutive_failures >= max_start_failures) {
+            instances.failed = true;
+        } else {
+            to_start.push_back(index);
+            start_requested.notify_one();
+        }
+        instance_ready.notify_all();
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bot.hpp"
+
+// keeps started bots ready so a match doesnt wait for a bot to load
+// every executable gets its own set of instances, a match leases one and gives it back when the game is done
+// instances are started on background threads, at first and again whenever one comes back crashed, timed out or invalid
+class BotPool {
+public:
+    // a bot that fails to start this many times in a row is given up on, acquire throws from then on
+    static constexpr int max_start_failures = 3;
+
+    // threads starting bots, later starts wait for one of them to be free
+    static constexpr size_t max_parallel_starts = 32;
+
+    // a leased bot, goes back to the pool when the lease is destroyed
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        Bot& operator*() const {
+            return *bot;
+        }
+
+        Bot* operator->() const {
+            return bot.get();
+        }
+
+        explicit operator bool() const {
+            return bot != nullptr;
+        }
+
+    private:
+        friend class BotPool;
+        Lease(BotPool* pool, size_t index, std::unique_ptr<Bot> bot) : pool(pool), index(index), bot(std::move(bot)) {}
+
+        BotPool* pool = nullptr;
+        size_t index = 0;
+        std::unique_ptr<Bot> bot;
+    };
+
+    // starts instances_per_bot instances of every path in the background, returns right away
+    BotPool(std::vector<std::string> paths, size_t instances_per_bot);
+
+    // every lease has to be given back before the pool goes away
+    ~BotPool();
+
+    BotPool(const BotPool&) = delete;
+    BotPool& operator=(const BotPool&) = delete;
+
+    // waits for a ready instance of paths[index], throws if that bot cant be started
+    Lease acquire(size_t index);
+
+    // instances of paths[index] that are started and not leased
+    size_t ready_count(size_t index) const;
+
+    // paths[index] failed to start max_start_failures times in a row and is not started again
+    bool has_failed(size_t index) const;
+
+private:
+    // a returned bot gets a stop so its next game starts clean, a crashed, timed out or invalid one is replaced
+    void release(size_t index, std::unique_ptr<Bot> bot);
+
+    void start_instances();
+
+    struct Instances {
+        std::string path;
+        std::vector<std::unique_ptr<Bot>> ready;
+        int consecutive_failures = 0;
+        bool failed = false;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable instance_ready;
+    std::condition_variable start_requested;
+    std::vector<Instances> bots;
+    // indices of bots that need an instance started
+    std::deque<size_t> to_start;
+    bool closing = false;
+    std::vector<std::thread> starters;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Constants.hpp"
+
+// how a request with a deadline ended
+enum class BotStatus : u8 {
+    Ok,
+    // nothing came back before the deadline, the bot forfeits
+    Timeout,
+    // the bot closed its output or died
+    Disconnected,
+    // the answer wasnt a valid message, the bot forfeits but stays connected
+    Invalid,
+};
+
+inline const char* describe(BotStatus status) {
+    switch (status) {
+    case BotStatus::Ok:
+        return "ok";
+    case BotStatus::Timeout:
+        return "timed out";
+    case BotStatus::Disconnected:
+        return "disconnected";
+    case BotStatus::Invalid:
+        return "sent an invalid message";
+    }
+    return "unknown";
+}
@@ -0,0 +1,465 @@
+#include "TBPReader.hpp"
+
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+
+// deeper than any TBP message nests, junk nested further is refused instead of recursing without end
+static constexpr int max_depth = 32;
+
+void TBPReader::fail(std::string_view expected) const {
+    std::string got;
+    if (pos >= line.size())
+        got = "the end of the line";
+    else
+        got = "'" + std::string(1, line[pos]) + "'";
+    fail_at(pos, "expected " + std::string(expected) + ", got " + got);
+}
+
+void TBPReader::fail_at(size_t at, std::string_view problem) const {
+    throw std::runtime_error("invalid " + std::string(message) + " at byte " + std::to_string(at) + ": " + std::string(problem));
+}
+
+void TBPReader::skip_whitespace() {
+    while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\n' || line[pos] == '\r'))
+        pos++;
+}
+
+bool TBPReader::take(char c) {
+    skip_whitespace();
+    if (pos < line.size() && line[pos] == c) {
+        pos++;
+        return true;
+    }
+    return false;
+}
+
+void TBPReader::expect(char c) {
+    if (!take(c))
+        fail(std::string("'") + c + "'");
+}
+
+void TBPReader::expect_end() {
+    skip_whitespace();
+    if (pos != line.size())
+        fail("the end of the line");
+}
+
+template <typename F>
+void TBPReader::object(F&& on_key) {
+    expect('{');
+    if (take('}'))
+        return;
+    do {
+        const std::string_view key = string();
+        expect(':');
+        on_key(key);
+    } while (take(','));
+    expect('}');
+}
+
+template <typename F>
+void TBPReader::array(F&& on_element) {
+    expect('[');
+    if (take(']'))
+        return;
+    size_t index = 0;
+    do {
+        on_element(index++);
+    } while (take(','));
+    expect(']');
+}
+
+// appends code point cp as utf-8
+static void append_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += char(cp);
+    } else if (cp < 0x800) {
+        out += char(0xC0 | cp >> 6);
+        out += char(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += char(0xE0 | cp >> 12);
+        out += char(0x80 | (cp >> 6 & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    } else {
+        out += char(0xF0 | cp >> 18);
+        out += char(0x80 | (cp >> 12 & 0x3F));
+        out += char(0x80 | (cp >> 6 & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+}
+
+std::string_view TBPReader::string() {
+    expect('"');
+    const size_t begin = pos;
+    // the common case has no escapes and is handed out as a view into the line
+    while (pos < line.size() && line[pos] != '"' && line[pos] != '\\') {
+        if (u8(line[pos]) < 0x20)
+            fail("a character that is allowed in a string");
+        pos++;
+    }
+    if (pos >= line.size())
+        fail("the closing '\"' of the string");
+    if (line[pos] == '"')
+        return line.substr(begin, pos++ - begin);
+
+    scratch.assign(line.substr(begin, pos - begin));
+    auto hex4 = [&]() -> uint32_t {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++, pos++) {
+            const char c = pos < line.size() ? line[pos] : '\0';
+            value <<= 4;
+            if (c >= '0' && c <= '9')
+                value |= uint32_t(c - '0');
+            else if (c >= 'a' && c <= 'f')
+                value |= uint32_t(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                value |= uint32_t(c - 'A' + 10);
+            else
+                fail("a hex digit");
+        }
+        return value;
+    };
+
+    while (true) {
+        if (pos >= line.size())
+            fail("the closing '\"' of the string");
+        const char c = line[pos];
+        if (c == '"') {
+            pos++;
+            return scratch;
+        }
+        if (u8(c) < 0x20)
+            fail("a character that is allowed in a string");
+        if (c != '\\') {
+            scratch += c;
+            pos++;
+            continue;
+        }
+
+        pos++;
+        const char escaped = pos < line.size() ? line[pos] : '\0';
+        switch (escaped) {
+        case '"':
+        case '\\':
+        case '/':
+            scratch += escaped;
+            break;
+        case 'b':
+            scratch += '\b';
+            break;
+        case 'f':
+            scratch += '\f';
+            break;
+        case 'n':
+            scratch += '\n';
+            break;
+        case 'r':
+            scratch += '\r';
+            break;
+        case 't':
+            scratch += '\t';
+            break;
+        case 'u': {
+            const size_t escape_at = pos - 1;
+            pos++;
+            uint32_t cp = hex4();
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                // a code point above the first plane comes as a surrogate pair
+                if (!(pos + 1 < line.size() && line[pos] == '\\' && line[pos + 1] == 'u'))
+                    fail_at(escape_at, "a high surrogate without the low one after it");
+                pos += 2;
+                const uint32_t low = hex4();
+                if (low < 0xDC00 || low > 0xDFFF)
+                    fail_at(escape_at, "a high surrogate without the low one after it");
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                fail_at(escape_at, "a low surrogate without the high one before it");
+            }
+            append_utf8(scratch, cp);
+            // hex4 already moved past the digits
+            continue;
+        }
+        default:
+            fail("an escape character");
+        }
+        pos++;
+    }
+}
+
+int TBPReader::integer(int min, int max) {
+    skip_whitespace();
+    const size_t begin = pos;
+    int value = 0;
+    auto [end, error] = std::from_chars(line.data() + pos, line.data() + line.size(), value);
+    if (error == std::errc::result_out_of_range)
+        fail_at(begin, "the number is out of range");
+    if (error != std::errc() || end == line.data() + pos)
+        fail("an integer");
+    pos = size_t(end - line.data());
+    // a fraction or an exponent would make it not an integer
+    if (pos < line.size() && (line[pos] == '.' || line[pos] == 'e' || line[pos] == 'E'))
+        fail("an integer");
+    if (value < min || value > max)
+        fail_at(begin, std::to_string(value) + " is outside " + std::to_string(min) + " to " + std::to_string(max));
+    return value;
+}
+
+void TBPReader::skip_value(int depth) {
+    if (depth > max_depth)
+        fail("less nesting");
+    skip_whitespace();
+    if (pos >= line.size())
+        fail("a value");
+
+    switch (line[pos]) {
+    case '"':
+        string();
+        return;
+    case '{':
+        object([&](std::string_view) { skip_value(depth + 1); });
+        return;
+    case '[':
+        array([&](size_t) { skip_value(depth + 1); });
+        return;
+    case 't':
+    case 'f':
+    case 'n': {
+        for (std::string_view literal : { "true", "false", "null" }) {
+            if (line.substr(pos, literal.size()) == literal) {
+                pos += literal.size();
+                return;
+            }
+        }
+        fail("a value");
+    }
+    default: {
+        // any json number, only its shape is checked
+        const size_t begin = pos;
+        if (line[pos] == '-')
+            pos++;
+        const size_t digits = pos;
+        while (pos < line.size() && ((line[pos] >= '0' && line[pos] <= '9') || line[pos] == '.' || line[pos] == 'e' || line[pos] == 'E' ||
+                                     line[pos] == '+' || line[pos] == '-'))
+            pos++;
+        if (pos == digits) {
+            pos = begin;
+            fail("a value");
+        }
+        return;
+    }
+    }
+}
+
+Piece TBPReader::move(size_t index) {
+    enum : unsigned { has_type = 1, has_orientation = 2, has_x = 4, has_y = 8, has_location = 16, has_spin = 32 };
+    unsigned found = 0;
+    PieceType type = PieceType::Empty;
+    RotationDirection orientation = North;
+    int x = 0;
+    int y = 0;
+    spinType spin = spinType::null;
+
+    skip_whitespace();
+    const size_t move_at = pos;
+    object([&](std::string_view key) {
+        if (key == "location") {
+            found |= has_location;
+            object([&](std::string_view key) {
+                // the first letter tells the keys apart, the rest is only checked
+                switch (key.empty() ? '\0' : key[0]) {
+                case 't':
+                    if (key != "type")
+                        break;
+                    {
+                        const size_t value_at = pos;
+                        const std::string_view value = string();
+                        switch (value.size() == 1 ? value[0] : '\0') {
+                        case 'S':
+                            type = PieceType::S;
+                            break;
+                        case 'Z':
+                            type = PieceType::Z;
+                            break;
+                        case 'J':
+                            type = PieceType::J;
+                            break;
+                        case 'L':
+                            type = PieceType::L;
+                            break;
+                        case 'T':
+                            type = PieceType::T;
+                            break;
+                        case 'O':
+                            type = PieceType::O;
+                            break;
+                        case 'I':
+                            type = PieceType::I;
+                            break;
+                        default:
+                            fail_at(value_at, "\"" + std::string(value) + "\" is not a piece, expected one of S Z J L T O I");
+                        }
+                    }
+                    found |= has_type;
+                    return;
+                case 'o':
+                    if (key != "orientation")
+                        break;
+                    {
+                        const size_t value_at = pos;
+                        const std::string_view value = string();
+                        bool valid = true;
+                        switch (value.empty() ? '\0' : value[0]) {
+                        case 'n':
+                            orientation = North;
+                            valid = value == "north";
+                            break;
+                        case 'e':
+                            orientation = East;
+                            valid = value == "east";
+                            break;
+                        case 's':
+                            orientation = South;
+                            valid = value == "south";
+                            break;
+                        case 'w':
+                            orientation = West;
+                            valid = value == "west";
+                            break;
+                        default:
+                            valid = false;
+                        }
+                        if (!valid)
+                            fail_at(value_at, "\"" + std::string(value) + "\" is not an orientation, expected north, east, south or west");
+                    }
+                    found |= has_orientation;
+                    return;
+                case 'x':
+                    if (key != "x")
+                        break;
+                    x = integer(INT8_MIN, INT8_MAX);
+                    found |= has_x;
+                    return;
+                case 'y':
+                    if (key != "y")
+                        break;
+                    y = integer(INT8_MIN, INT8_MAX);
+                    found |= has_y;
+                    return;
+                }
+                skip_value(1);
+            });
+        } else if (key == "spin") {
+            const size_t value_at = pos;
+            const std::string_view value = string();
+            bool valid = true;
+            switch (value.empty() ? '\0' : value[0]) {
+            case 'n':
+                spin = spinType::null;
+                valid = value == "none";
+                break;
+            case 'm':
+                spin = spinType::mini;
+                valid = value == "mini";
+                break;
+            case 'f':
+                spin = spinType::normal;
+                valid = value == "full";
+                break;
+            default:
+                valid = false;
+            }
+            if (!valid)
+                fail_at(value_at, "\"" + std::string(value) + "\" is not a spin, expected none, mini or full");
+            found |= has_spin;
+        } else {
+            skip_value(1);
+        }
+    });
+
+    static constexpr std::pair<unsigned, const char*> required[] = {
+        { has_location, "location" }, { has_type, "location.type" }, { has_orientation, "location.orientation" },
+        { has_x, "location.x" },      { has_y, "location.y" },       { has_spin, "spin" },
+    };
+    for (const auto& [flag, name] : required)
+        if (!(found & flag))
+            fail_at(move_at, "move " + std::to_string(index) + " has no " + name);
+
+    return Piece(type, Coord{ int8_t(x), int8_t(y) }, orientation, spin);
+}
+
+void TBPReader::suggestion(std::string_view line, std::vector<Piece>& moves) {
+    TBPReader reader(line, "suggestion");
+    moves.clear();
+    bool has_moves = false;
+    bool has_type = false;
+    reader.object([&](std::string_view key) {
+        if (key == "type") {
+            const size_t value_at = reader.pos;
+            if (reader.string() != "suggestion")
+                reader.fail_at(value_at, "the type is not suggestion");
+            has_type = true;
+        } else if (key == "moves") {
+            has_moves = true;
+            reader.array([&](size_t index) { moves.push_back(reader.move(index)); });
+        } else {
+            reader.skip_value(1);
+        }
+    });
+    reader.expect_end();
+    if (!has_type)
+        reader.fail_at(0, "there is no type");
+    if (!has_moves)
+        reader.fail_at(0, "there are no moves");
+}
+
+TBPInfo TBPReader::info(std::string_view line) {
+    TBPReader reader(line, "info");
+    TBPInfo info;
+    bool has_type = false, has_name = false, has_author = false, has_version = false;
+    reader.object([&](std::string_view key) {
+        if (key == "type") {
+            const size_t value_at = reader.pos;
+            if (reader.string() != "info")
+                reader.fail_at(value_at, "the type is not info");
+            has_type = true;
+        } else if (key == "name") {
+            info.name = reader.string();
+            has_name = true;
+        } else if (key == "author") {
+            info.author = reader.string();
+            has_author = true;
+        } else if (key == "version") {
+            info.version = reader.string();
+            has_version = true;
+        } else {
+            // features and anything newer
+            reader.skip_value(1);
+        }
+    });
+    reader.expect_end();
+    if (!has_type)
+        reader.fail_at(0, "there is no type");
+    if (!has_name || !has_author || !has_version)
+        reader.fail_at(0, std::string("there is no ") + (!has_name ? "name" : !has_author ? "author" : "version"));
+    return info;
+}
+
+void TBPReader::ready(std::string_view line) {
+    TBPReader reader(line, "ready");
+    std::string type;
+    std::string reason;
+    reader.object([&](std::string_view key) {
+        if (key == "type")
+            type = reader.string();
+        else if (key == "reason")
+            reason = reader.string();
+        else
+            reader.skip_value(1);
+    });
+    reader.expect_end();
+    if (type == "error")
+        throw std::runtime_error("the bot refused the rules: " + (reason.empty() ? std::string("no reason given") : reason));
+    if (type != "ready")
+        reader.fail_at(0, type.empty() ? "there is no type" : "the type is " + type + ", not ready");
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Piece.hpp"
+
+// what a bot says about itself in its info message
+struct TBPInfo {
+    std::string name;
+    std::string author;
+    std::string version;
+};
+
+// reads the TBP messages bots send in one pass over the line, straight into the values the stadium wants, no json objects in between
+// keys can come in any order and keys it doesnt know are skipped, anything that isnt valid json or valid TBP throws
+// a std::runtime_error that says which message, at which byte and what was expected there
+class TBPReader {
+public:
+    // the moves of a suggestion in the order the bot sent them, moves is cleared first so its capacity is reused
+    static void suggestion(std::string_view line, std::vector<Piece>& moves);
+
+    static TBPInfo info(std::string_view line);
+
+    // throws with the bots reason if it answered the rules with an error instead
+    static void ready(std::string_view line);
+
+private:
+    TBPReader(std::string_view line, const char* message) : line(line), message(message) {}
+
+    [[noreturn]] void fail(std::string_view expected) const;
+    [[noreturn]] void fail_at(size_t at, std::string_view problem) const;
+
+    void skip_whitespace();
+    // skips whitespace and takes c if it is next
+    bool take(char c);
+    void expect(char c);
+    // whitespace and then the end of the line
+    void expect_end();
+
+    // a string, the view points into the line or into scratch when it had escapes
+    // so it is only good until the next string is read
+    std::string_view string();
+    int integer(int min, int max);
+    // any value, of whatever type
+    void skip_value(int depth = 0);
+
+    // calls on_key(key) for every key, on_key has to read the value
+    template <typename F>
+    void object(F&& on_key);
+    // calls on_element(index) for every element, on_element has to read it
+    template <typename F>
+    void array(F&& on_element);
+
+    // reads one move of a suggestion
+    Piece move(size_t index);
+
+    std::string_view line;
+    const char* message;
+    size_t pos = 0;
+    std::string scratch;
+};
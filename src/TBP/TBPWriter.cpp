@@ -0,0 +1,166 @@
+#include "TBPWriter.hpp"
+
+#include <charconv>
+#include <stdexcept>
+
+// a real piece as its TBP letter, nullptr for anything else
+static const char* piece_letter(PieceType type) {
+    switch (type) {
+    case PieceType::S:
+        return "S";
+    case PieceType::Z:
+        return "Z";
+    case PieceType::J:
+        return "J";
+    case PieceType::L:
+        return "L";
+    case PieceType::T:
+        return "T";
+    case PieceType::O:
+        return "O";
+    case PieceType::I:
+        return "I";
+    default:
+        return nullptr;
+    }
+}
+
+void TBPWriter::append_int(int value) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+}
+
+void TBPWriter::append_piece(PieceType type) {
+    const char* letter = piece_letter(type);
+    if (!letter)
+        throw std::runtime_error("invalid piece");
+    buffer += '"';
+    buffer += letter;
+    buffer += '"';
+}
+
+void TBPWriter::append_board(const Board& board, size_t rows, size_t filled_rows) {
+    buffer += '[';
+    for (size_t y = 0; y < rows; y++) {
+        if (y != 0)
+            buffer += ',';
+        buffer += '[';
+        for (size_t x = 0; x < Board::width; x++) {
+            if (x != 0)
+                buffer += ',';
+            if (y < filled_rows && board.get(x, y))
+                buffer += "\"G\"";
+            else
+                buffer += "null";
+        }
+        buffer += ']';
+    }
+    buffer += ']';
+}
+
+std::string_view TBPWriter::start(const Game& opp, const Board& board, const std::vector<PieceType>& queue, std::optional<Piece> hold, bool back_to_back,
+                                  int combo) {
+    buffer.clear();
+    buffer += "{\"back_to_back\":";
+    buffer += back_to_back ? "true" : "false";
+
+    buffer += ",\"board\":";
+    append_board(board, 40, Board::visual_height);
+
+    buffer += ",\"combo\":";
+    append_int(combo);
+
+    buffer += ",\"hold\":";
+    if (hold.has_value() && hold->type == PieceType::Empty) {
+        // an empty hold piece has always gone out as an I
+        buffer += "\"I\"";
+    } else if (hold.has_value() && piece_letter(hold->type)) {
+        append_piece(hold->type);
+    } else {
+        buffer += "null";
+    }
+
+    buffer += ",\"opponents\":[{\"board\":";
+    append_board(opp.board, Board::height, Board::height);
+    buffer += "}]";
+
+    buffer += ",\"queue\":[";
+    for (size_t i = 0; i < queue.size(); i++) {
+        if (i != 0)
+            buffer += ',';
+        append_piece(queue[i]);
+    }
+    buffer += "],\"type\":\"start\"}";
+    return buffer;
+}
+
+std::string_view TBPWriter::play(const Game& opp, const Piece& piece) {
+    static constexpr const char* orientations[] = { "north", "east", "south", "west" };
+    static constexpr const char* spins[] = { "none", "mini", "full" };
+    if (piece.rotation > West)
+        throw std::runtime_error("invalid direction");
+    if (u8(piece.spin) > u8(spinType::normal))
+        throw std::runtime_error("invalid spin");
+
+    buffer.clear();
+    buffer += "{\"move\":{\"location\":{\"orientation\":\"";
+    buffer += orientations[piece.rotation];
+    buffer += "\",\"type\":";
+    append_piece(piece.type);
+    buffer += ",\"x\":";
+    append_int(piece.position.x);
+    buffer += ",\"y\":";
+    append_int(piece.position.y);
+    buffer += "},\"spin\":\"";
+    buffer += spins[u8(piece.spin)];
+    buffer += "\"}";
+
+    buffer += ",\"opponents\":[{\"back_to_back\":";
+    append_int(opp.stats.b2b);
+    buffer += ",\"board\":";
+    append_board(opp.board, Board::height, Board::height);
+    buffer += ",\"combo\":";
+    append_int(opp.stats.combo);
+    buffer += ",\"meter\":";
+    append_int(opp.garbage_meter);
+
+    // anything that isnt a piece goes out as an empty string
+    buffer += ",\"queue\":[\"";
+    if (const char* letter = piece_letter(opp.current_piece.type))
+        buffer += letter;
+    buffer += '"';
+    for (PieceType type : opp.queue) {
+        buffer += ",\"";
+        if (const char* letter = piece_letter(type))
+            buffer += letter;
+        buffer += '"';
+    }
+    buffer += "]}],\"type\":\"play\"}";
+    return buffer;
+}
+
+std::string_view TBPWriter::new_piece(PieceType type) {
+    const char* letter = piece_letter(type);
+    buffer.clear();
+    buffer += "{\"piece\":\"";
+    buffer += letter ? letter : "Error";
+    buffer += "\",\"type\":\"new_piece\"}";
+    return buffer;
+}
+
+std::string_view TBPWriter::suggest() {
+    return "{\"type\":\"suggest\"}";
+}
+
+std::string_view TBPWriter::stop() {
+    return "{\"type\":\"stop\"}";
+}
+
+std::string_view TBPWriter::quit() {
+    return "{\"type\":\"quit\"}";
+}
+
+std::string_view TBPWriter::rules() {
+    return "{\"type\":\"rules\"}";
+}
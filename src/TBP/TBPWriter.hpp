@@ -0,0 +1,45 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Board.hpp"
+#include "Game.hpp"
+#include "Piece.hpp"
+
+// writes the TBP messages the stadium sends straight from the game into one reused buffer, no json objects in between
+// the output is byte for byte what dumping the nlohmann::json Bot used to build gives, keys in sorted order and all
+// every call overwrites the buffer, the view it returns is good until the next call
+class TBPWriter {
+public:
+    TBPWriter() {
+        // a start message is the biggest, about 3kB, so after this writing never allocates
+        buffer.reserve(4096);
+    }
+
+    // the board rows at and above visual_height are sent empty, the 40 rows TBP expects
+    std::string_view start(const Game& opp, const Board& board, const std::vector<PieceType>& queue, std::optional<Piece> hold, bool back_to_back,
+                           int combo);
+
+    std::string_view play(const Game& opp, const Piece& piece);
+
+    std::string_view new_piece(PieceType type);
+
+    std::string_view suggest();
+
+    std::string_view stop();
+
+    std::string_view quit();
+
+    std::string_view rules();
+
+private:
+    void append_int(int value);
+    void append_piece(PieceType type);
+    // [row 0, row 1, ...] with "G" for filled cells, rows at and above filled_rows are all null
+    void append_board(const Board& board, size_t rows, size_t filled_rows);
+
+    std::string buffer;
+};
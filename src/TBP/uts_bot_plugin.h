@@ -0,0 +1,103 @@
+#ifndef UTS_BOT_PLUGIN_H
+#define UTS_BOT_PLUGIN_H
+
+/*
+    The in process alternative to TBP: a bot built as a shared library that exports the functions below.
+    The stadium loads it with dlopen (LoadLibrary on windows) when the bot path ends in .so, .dylib or .dll,
+    and plays it through the same match loop as a TBP bot, but with plain structs instead of json over pipes.
+
+    Only C types cross the boundary so a bot can be written in any language that can export C functions.
+    A library can be loaded for several bots at once, every uts_bot_create makes an independent instance.
+    Calls on one instance never overlap, calls on different instances can come from different threads at the same time.
+
+    A move is 16 bits, the same packing the stadium's datasets and replays use:
+        bits 0-2   piece type, UTS_PIECE_*
+        bits 3-4   orientation, 0 north, 1 east, 2 south, 3 west
+        bits 5-8   x of the piece center, 0 is the left column
+        bits 9-13  y of the piece center, 0 is the bottom row
+        bits 14-15 spin, 0 none, 1 mini, 2 full
+    A move of a piece other than the current one holds first, like a TBP suggestion.
+*/
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// bumped whenever a struct or a function below changes, a bot built for another version is refused
+#define UTS_BOT_PLUGIN_ABI_VERSION 1
+
+#define UTS_PIECE_S 0
+#define UTS_PIECE_Z 1
+#define UTS_PIECE_J 2
+#define UTS_PIECE_L 3
+#define UTS_PIECE_T 4
+#define UTS_PIECE_O 5
+#define UTS_PIECE_I 6
+#define UTS_PIECE_NONE 7
+
+#define UTS_BOARD_WIDTH 10
+#define UTS_BOARD_HEIGHT 32
+#define UTS_QUEUE_CAPACITY 8
+
+#ifdef _WIN32
+#define UTS_BOT_EXPORT __declspec(dllexport)
+#else
+#define UTS_BOT_EXPORT __attribute__((visibility("default")))
+#endif
+
+// filled in by the bot when an instance is created, what TBP sends in its info message
+typedef struct uts_bot_info {
+    char name[64];
+    char author[64];
+    char version[64];
+} uts_bot_info;
+
+// one player's side of the game
+typedef struct uts_player_state {
+    // bit y of board[x] is the cell at column x row y, rows count up from the bottom
+    uint32_t board[UTS_BOARD_WIDTH];
+    // the current piece first, then the previews
+    uint8_t queue[UTS_QUEUE_CAPACITY];
+    uint8_t queue_length;
+    // UTS_PIECE_NONE when nothing is held
+    uint8_t hold;
+    uint8_t back_to_back;
+    uint8_t padding;
+    int32_t combo;
+    // garbage waiting to be received
+    int32_t meter;
+} uts_player_state;
+
+// the abi version the library was built against, checked before anything else is called
+typedef uint32_t (*uts_bot_abi_version_fn)(void);
+// a new instance, null if it couldnt be made
+typedef void* (*uts_bot_create_fn)(uts_bot_info* info);
+typedef void (*uts_bot_destroy_fn)(void* bot);
+// a new game from this position, also sent mid game when garbage changed the board
+typedef void (*uts_bot_start_fn)(void* bot, const uts_player_state* self, const uts_player_state* opponent);
+// writes up to capacity moves, most preferred first, returns how many were written
+// 0 means the bot sees no move, a negative count means it failed and forfeits
+typedef int32_t (*uts_bot_suggest_fn)(void* bot, uint16_t* moves, int32_t capacity);
+// the move the bot made was played, opponent is the other side after the turn
+typedef void (*uts_bot_play_fn)(void* bot, uint16_t move, const uts_player_state* opponent);
+// a piece was added to the end of the queue
+typedef void (*uts_bot_new_piece_fn)(void* bot, uint8_t piece);
+// the game is over, a start may follow
+typedef void (*uts_bot_stop_fn)(void* bot);
+
+UTS_BOT_EXPORT uint32_t uts_bot_abi_version(void);
+UTS_BOT_EXPORT void* uts_bot_create(uts_bot_info* info);
+UTS_BOT_EXPORT void uts_bot_destroy(void* bot);
+UTS_BOT_EXPORT void uts_bot_start(void* bot, const uts_player_state* self, const uts_player_state* opponent);
+UTS_BOT_EXPORT int32_t uts_bot_suggest(void* bot, uint16_t* moves, int32_t capacity);
+UTS_BOT_EXPORT void uts_bot_play(void* bot, uint16_t move, const uts_player_state* opponent);
+UTS_BOT_EXPORT void uts_bot_new_piece(void* bot, uint8_t piece);
+UTS_BOT_EXPORT void uts_bot_stop(void* bot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
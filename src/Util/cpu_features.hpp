@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define UTS_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// instruction set extensions that are picked at runtime instead of at compile time
+struct CpuFeatures {
+    bool bmi2 = false;
+    // pext is microcoded on amd before zen 3, it is slower than shifting there
+    bool fast_pext = false;
+};
+
+inline CpuFeatures detect_cpu_features() {
+    CpuFeatures features;
+#ifdef UTS_X86
+    unsigned int regs[4]{};  // eax, ebx, ecx, edx
+
+    auto cpuid = [&regs](unsigned int leaf, unsigned int subleaf) {
+#ifdef _MSC_VER
+        int out[4];
+        __cpuidex(out, (int)leaf, (int)subleaf);
+        std::memcpy(regs, out, sizeof(regs));
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    };
+
+    cpuid(0, 0);
+    const unsigned int max_leaf = regs[0];
+    char vendor[13]{};
+    std::memcpy(vendor, &regs[1], 4);
+    std::memcpy(vendor + 4, &regs[3], 4);
+    std::memcpy(vendor + 8, &regs[2], 4);
+
+    if (max_leaf < 7)
+        return features;
+
+    cpuid(1, 0);
+    unsigned int family = (regs[0] >> 8) & 0xf;
+    if (family == 0xf)
+        family += (regs[0] >> 20) & 0xff;
+
+    cpuid(7, 0);
+    features.bmi2 = (regs[1] >> 8) & 1;
+
+    const bool amd = std::strcmp(vendor, "AuthenticAMD") == 0 || std::strcmp(vendor, "HygonGenuine") == 0;
+    features.fast_pext = features.bmi2 && !(amd && family < 0x19);
+#endif
+    return features;
+}
+
+// detected once at startup
+inline const CpuFeatures cpu_features = detect_cpu_features();
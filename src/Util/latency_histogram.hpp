@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// counts durations in log spaced buckets, every power of two is split into sub_buckets linear ones
+// recording is a couple of shifts and an increment, values are kept in microseconds
+// with a relative error under 1 / sub_buckets
+class LatencyHistogram {
+public:
+    static constexpr int sub_bucket_bits = 3;
+    static constexpr int sub_buckets = 1 << sub_bucket_bits;
+    static constexpr int bucket_count = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+    void record(std::chrono::steady_clock::duration duration) {
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+        record(uint64_t(std::max<decltype(micros)>(micros, 0)));
+    }
+
+    void record(uint64_t micros) {
+        counts[bucket_of(micros)]++;
+        total++;
+        largest = std::max(largest, micros);
+    }
+
+    uint64_t count() const {
+        return total;
+    }
+
+    uint64_t max() const {
+        return largest;
+    }
+
+    // the value at or below which the given fraction of the recorded values are, rounded up to its bucket
+    uint64_t percentile(double fraction) const {
+        if (total == 0)
+            return 0;
+
+        const uint64_t rank = std::clamp<uint64_t>(uint64_t(std::ceil(fraction * double(total))), 1, total);
+        uint64_t seen = 0;
+        for (int i = 0; i < bucket_count; i++) {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::min(bucket_upper_bound(i), largest);
+        }
+        return largest;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < bucket_count; i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        largest = std::max(largest, other.largest);
+    }
+
+    void clear() {
+        counts.fill(0);
+        total = 0;
+        largest = 0;
+    }
+
+private:
+    static int bucket_of(uint64_t value) {
+        if (value < sub_buckets)
+            return int(value);
+        // keep the top sub_bucket_bits + 1 bits, the leading one picks the power of two and the rest the sub bucket
+        const int shift = std::bit_width(value) - sub_bucket_bits - 1;
+        return (shift + 1) * sub_buckets + int(value >> shift) - sub_buckets;
+    }
+
+    static uint64_t bucket_upper_bound(int bucket) {
+        if (bucket < sub_buckets)
+            return uint64_t(bucket);
+        const int shift = bucket / sub_buckets - 1;
+        const uint64_t mantissa = sub_buckets + bucket % sub_buckets;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    std::array<uint64_t, bucket_count> counts{};
+    uint64_t total = 0;
+    uint64_t largest = 0;
+};
@@ -0,0 +1,170 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#undef min
+#undef max
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// a whole file mapped into memory, pages are read in by the os when they are first touched
+// so a file much bigger than memory can still be indexed anywhere without reading it first
+class mapped_file {
+public:
+    mapped_file() = default;
+
+    // read only view of an existing file
+    static mapped_file open(const std::filesystem::path& path) {
+        mapped_file file;
+        file.map(path, 0, false);
+        return file;
+    }
+
+    // creates or truncates the file to size bytes, all zero, and maps it writable
+    static mapped_file create(const std::filesystem::path& path, size_t size) {
+        mapped_file file;
+        file.map(path, size, true);
+        return file;
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept {
+        swap(other);
+    }
+
+    mapped_file& operator=(mapped_file&& other) noexcept {
+        mapped_file(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    ~mapped_file() {
+        unmap();
+    }
+
+    const std::byte* data() const {
+        return bytes;
+    }
+
+    std::byte* data() {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    // writes the changed pages back to the file, unmapping does it too but without reporting errors
+    void flush() {
+        if (!bytes)
+            return;
+#ifdef _WIN32
+        if (!FlushViewOfFile(bytes, 0))
+            throw std::runtime_error("couldnt flush the mapped file");
+#else
+        if (msync(bytes, length, MS_SYNC) != 0)
+            throw std::runtime_error("couldnt flush the mapped file");
+#endif
+    }
+
+private:
+    void map(const std::filesystem::path& path, size_t size, bool writable) {
+#ifdef _WIN32
+        file = CreateFileW(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, NULL,
+                           writable ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("couldnt open " + path.string());
+
+        if (!writable) {
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file, &file_size))
+                throw std::runtime_error("couldnt get the size of " + path.string());
+            size = size_t(file_size.QuadPart);
+        }
+        if (size == 0)
+            throw std::runtime_error(path.string() + " is empty");
+
+        mapping = CreateFileMappingW(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, DWORD(uint64_t(size) >> 32), DWORD(size), NULL);
+        if (mapping == NULL)
+            throw std::runtime_error("couldnt map " + path.string());
+
+        bytes = (std::byte*)MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+        if (bytes == nullptr)
+            throw std::runtime_error("couldnt map " + path.string());
+#else
+        fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("couldnt open " + path.string());
+
+        if (writable) {
+            if (ftruncate(fd, off_t(size)) != 0)
+                throw std::runtime_error("couldnt resize " + path.string());
+        } else {
+            struct stat info;
+            if (fstat(fd, &info) != 0)
+                throw std::runtime_error("couldnt get the size of " + path.string());
+            size = size_t(info.st_size);
+        }
+        if (size == 0)
+            throw std::runtime_error(path.string() + " is empty");
+
+        void* address = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED)
+            throw std::runtime_error("couldnt map " + path.string());
+        bytes = (std::byte*)address;
+#endif
+        length = size;
+    }
+
+    void unmap() {
+#ifdef _WIN32
+        if (bytes)
+            UnmapViewOfFile(bytes);
+        if (mapping != NULL)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes)
+            munmap(bytes, length);
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+#endif
+        bytes = nullptr;
+        length = 0;
+    }
+
+    void swap(mapped_file& other) noexcept {
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+#ifdef _WIN32
+        std::swap(file, other.file);
+        std::swap(mapping, other.mapping);
+#else
+        std::swap(fd, other.fd);
+#endif
+    }
+
+    std::byte* bytes = nullptr;
+    size_t length = 0;
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int fd = -1;
+#endif
+};
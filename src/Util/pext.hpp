@@ -1,19 +1,22 @@
+#pragma once
+#include <bit>
 #include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <climits>
 #include <type_traits>
 
-// if either clang/gcc
-#ifdef __GNUC__
-#ifndef __clang__
-#ifdef __BMI2__
-// gcc
-#include <immintrin.h>
-#endif
-#elif
-// clang
+#include "cpu_features.hpp"
+
+#ifdef UTS_X86
 #include <immintrin.h>
 #endif
+
+// functions that use bmi2 without the whole binary being compiled for it
+#if defined(UTS_X86) && defined(__GNUC__)
+#define UTS_TARGET_BMI2 __attribute__((target("bmi2")))
+#else
+#define UTS_TARGET_BMI2
 #endif
 
 // this is not specific to any architecture or integer size
@@ -26,7 +29,7 @@ constexpr T pext_impl(const T SRC, const T MASK) {
     int m = 0, k = 0;  // iterators
     do {
         if ((MASK >> m) & 1) {
-            DEST |= (SRC & (1 << m)) >> (m - k);
+            DEST |= (SRC & (T(1) << m)) >> (m - k);
             k = k + 1;
         }
         m = m + 1;
@@ -35,27 +38,88 @@ constexpr T pext_impl(const T SRC, const T MASK) {
     return DEST;
 }
 
+#ifdef UTS_X86
+UTS_TARGET_BMI2 inline std::uint32_t pext_bmi2(std::uint32_t src, std::uint32_t mask) {
+    return _pext_u32(src, mask);
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+UTS_TARGET_BMI2 inline std::uint64_t pext_bmi2(std::uint64_t src, std::uint64_t mask) {
+    return _pext_u64(src, mask);
+}
+#endif
+#endif
+
 template <std::integral T>
 constexpr T pext(const T src, const T mask) {
     if (std::is_constant_evaluated()) {
         return pext_impl(src, mask);
     }
 
-#if defined(__GNUC__) && defined(__BMI2__)
-
-    if constexpr (std::same_as<T, std::uint64_t>) {
-        return _pext_u64(src, mask);
+#ifdef UTS_X86
+    if constexpr (std::same_as<T, std::uint32_t>) {
+        if (cpu_features.bmi2)
+            return pext_bmi2(src, mask);
     }
-    else if constexpr (std::same_as<T, std::uint32_t>) {
-        return _pext_u32(src, mask);
+#if defined(__x86_64__) || defined(_M_X64)
+    else if constexpr (std::same_as<T, std::uint64_t>) {
+        if (cpu_features.bmi2)
+            return pext_bmi2(src, mask);
     }
-    else {
-        return pext_impl(src, mask);
+#endif
+#endif
+
+    return pext_impl(src, mask);
+}
+
+// removes the given rows from every column, the rows above them fall down to fill the gap
+// one shift per run of adjacent rows, cleared lines are nearly always a single run so this beats a bit by bit pext
+inline void remove_rows_shift(std::uint32_t* columns, std::size_t count, std::uint32_t rows) {
+    while (rows) {
+        // highest run first so the lower rows stay where they are
+        const int top = 31 - std::countl_zero(rows);
+        const std::uint32_t gaps = ~rows & ((1u << top) - 1);
+        const int bottom = gaps ? 32 - std::countl_zero(gaps) : 0;
+        const int run = top - bottom + 1;
+
+        const std::uint32_t below = (1u << bottom) - 1;
+        rows &= below;
+
+        for (std::size_t i = 0; i < count; i++)
+            columns[i] = (columns[i] & below) | (std::uint32_t(std::uint64_t(columns[i]) >> run) & ~below);
     }
+}
 
-#else
+// undoes remove_rows, pushes the rows above each given row up and fills the given rows
+inline void insert_full_rows(std::uint32_t* columns, std::size_t count, std::uint32_t rows) {
+    while (rows) {
+        // lowest run first, the rows are where they end up after every run is back
+        const int bottom = std::countr_zero(rows);
+        const std::uint32_t ones = ~rows & ~((1u << bottom) - 1);
+        const int top = ones ? std::countr_zero(ones) - 1 : 31;
+        const int run = top - bottom + 1;
 
-    return pext_impl(src, mask);
+        const std::uint32_t below = (1u << bottom) - 1;
+        const std::uint32_t filled = std::uint32_t(((std::uint64_t(1) << run) - 1) << bottom);
+        rows &= ~filled;
 
+        for (std::size_t i = 0; i < count; i++)
+            columns[i] = (columns[i] & below) | filled | (std::uint32_t(std::uint64_t(columns[i]) << run) & ~(below | filled));
+    }
+}
+
+#ifdef UTS_X86
+UTS_TARGET_BMI2 inline void remove_rows_pext(std::uint32_t* columns, std::size_t count, std::uint32_t rows) {
+    const std::uint32_t kept = ~rows;
+    for (std::size_t i = 0; i < count; i++)
+        columns[i] = _pext_u32(columns[i], kept);
+}
 #endif
-}
\ No newline at end of file
+
+inline void remove_rows(std::uint32_t* columns, std::size_t count, std::uint32_t rows) {
+#ifdef UTS_X86
+    if (cpu_features.fast_pext)
+        return remove_rows_pext(columns, count, rows);
+#endif
+    remove_rows_shift(columns, count, rows);
+}
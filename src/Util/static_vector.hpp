@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// vector with a fixed capacity that lives entirely inside the object, it never allocates
+// the elements dont need to be default constructible
+// pushing past the capacity throws std::length_error in every build, it is checked once per push and never taken in practice
+template <typename T, size_t N>
+class static_vector {
+    static_assert(std::is_trivially_destructible_v<T>, "static_vector only holds trivially destructible types");
+
+public:
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    static_vector() = default;
+
+    static_vector(const static_vector& other) {
+        std::uninitialized_copy(other.begin(), other.end(), begin());
+        count = other.count;
+    }
+
+    static_vector& operator=(const static_vector& other) {
+        if (this != &other) {
+            std::uninitialized_copy(other.begin(), other.end(), begin());
+            count = other.count;
+        }
+        return *this;
+    }
+
+    ~static_vector() = default;
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (count == N) [[unlikely]]
+            full();
+        T* element = std::construct_at(data() + count, std::forward<Args>(args)...);
+        count++;
+        return *element;
+    }
+
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    void clear() {
+        count = 0;
+    }
+
+    static constexpr size_t capacity() {
+        return N;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    T* data() {
+        return std::launder(reinterpret_cast<T*>(storage));
+    }
+
+    const T* data() const {
+        return std::launder(reinterpret_cast<const T*>(storage));
+    }
+
+    T& operator[](size_t i) {
+        return data()[i];
+    }
+
+    const T& operator[](size_t i) const {
+        return data()[i];
+    }
+
+    iterator begin() {
+        return data();
+    }
+
+    iterator end() {
+        return data() + count;
+    }
+
+    const_iterator begin() const {
+        return data();
+    }
+
+    const_iterator end() const {
+        return data() + count;
+    }
+
+private:
+    // the throw is kept out of emplace_back so pushes stay small enough to inline
+    [[noreturn]] static void full() {
+        throw std::length_error("static_vector is full");
+    }
+
+    alignas(T) std::byte storage[N * sizeof(T)];
+    size_t count = 0;
+};
@@ -0,0 +1,493 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "Dataset/Columnar.hpp"
+#include "Dataset/GameState.hpp"
+#include "Dataset/Replay.hpp"
+#include "Dataset/Schema.hpp"
+
+#include "sqlite3.h"
+
+// maintenance for the databases stadium_cli writes
+//   migrate <database> [games_per_batch]  converts an older Data table to the current schema in place
+//   export <database> <output>            writes the Data table as a columnar dataset, see Dataset/Columnar.hpp
+//   verify-replay <database> <replay>     replays every game of a replay file and checks it against the Data table
+
+constexpr int default_games_per_batch = 256;
+
+void exec(sqlite3* db, const std::string& sql) {
+	char* err_msg = 0;
+	if(sqlite3_exec(db, sql.c_str(), 0, 0, &err_msg) != SQLITE_OK) {
+		std::string err = "SQL error (" + sql + "): " + (err_msg ? err_msg : sqlite3_errmsg(db));
+		sqlite3_free(err_msg);
+		throw std::runtime_error(err);
+	}
+}
+
+sqlite3_stmt* prepare(sqlite3* db, const std::string& sql) {
+	sqlite3_stmt* stmt = nullptr;
+	if(sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+		throw std::runtime_error("Failed to prepare statement: " + std::string(sqlite3_errmsg(db)));
+	return stmt;
+}
+
+sqlite3_int64 query_int(sqlite3* db, const std::string& sql) {
+	sqlite3_stmt* stmt = prepare(db, sql);
+	sqlite3_int64 value = 0;
+	if(sqlite3_step(stmt) == SQLITE_ROW)
+		value = sqlite3_column_int64(stmt, 0);
+	sqlite3_finalize(stmt);
+	return value;
+}
+
+std::string_view column_text(sqlite3_stmt* stmt, int column) {
+	const unsigned char* text = sqlite3_column_text(stmt, column);
+	return text ? std::string_view((const char*)text, sqlite3_column_bytes(stmt, column)) : std::string_view();
+}
+
+// v1 boards are 200 byte blobs with a byte per cell, v2 ones 25 bytes with the visible rows packed, later ones are current
+packed_board blob_board(const void* blob, int size) {
+	packed_board packed{};
+	if(size == (int)packed.bytes.size()) {
+		std::memcpy(packed.bytes.data(), blob, packed.bytes.size());
+	} else if(size == 10 * 20) {
+		std::array<u8, 10 * 20> cells;
+		std::memcpy(cells.data(), blob, cells.size());
+		packed = pack_board(unpack_board(cells));
+	} else if(size == Board::width * Board::visual_height / 8) {
+		std::array<u8, Board::width * Board::visual_height / 8> bytes;
+		std::memcpy(bytes.data(), blob, bytes.size());
+		packed = pack_board(unpack_board(bytes));
+	} else {
+		throw std::runtime_error("board blob of " + std::to_string(size) + " bytes");
+	}
+	return packed;
+}
+
+packed_board column_board(sqlite3_stmt* stmt, int column) {
+	return blob_board(sqlite3_column_blob(stmt, column), sqlite3_column_bytes(stmt, column));
+}
+
+// current_board(blob) in sql, any board blob as the current packing
+void current_board_function(sqlite3_context* context, int, sqlite3_value** args) {
+	try {
+		const packed_board board = blob_board(sqlite3_value_blob(args[0]), sqlite3_value_bytes(args[0]));
+		sqlite3_result_blob(context, board.bytes.data(), (int)board.bytes.size(), SQLITE_TRANSIENT);
+	} catch(const std::exception& e) {
+		sqlite3_result_error(context, e.what(), -1);
+	}
+}
+
+// the v1 columns of one player without the p1_ / p2_ prefix, in the order they are read
+constexpr std::array<const char*, 16> v1_player_columns = {
+	"board", "current_piece", "move_piece_type", "move_piece_rot", "move_piece_x", "move_piece_y",
+	"meter", "attack", "damage_received", "spun", "queue_0", "queue_1", "queue_2", "queue_3", "queue_4", "hold"
+};
+constexpr int v1_player_column_count = (int)v1_player_columns.size();
+
+std::string v1_select_sql() {
+	std::string sql = "SELECT game_id, move_index, state";
+	for(const char* prefix : { "p1_", "p2_" })
+		for(const char* column : v1_player_columns)
+			sql += std::string(", ") + prefix + column;
+	return sql + " FROM Data WHERE game_id <= ? ORDER BY game_id, move_index;";
+}
+
+// copies one v1 row from select into the bound parameters of insert
+void convert_row(sqlite3_stmt* select, sqlite3_stmt* insert) {
+	int index = 1;
+	sqlite3_bind_int64(insert, index++, sqlite3_column_int64(select, 0));
+	sqlite3_bind_int(insert, index++, sqlite3_column_int(select, 1));
+	sqlite3_bind_int(insert, index++, game_state_from_text(column_text(select, 2)));
+
+	for(int p = 0; p < 2; p++) {
+		const int base = 3 + p * v1_player_column_count;
+
+		const packed_board board = column_board(select, base);
+		sqlite3_bind_blob(insert, index++, board.bytes.data(), (int)board.bytes.size(), SQLITE_TRANSIENT);
+		sqlite3_bind_int(insert, index++, piece_type_from_text(column_text(select, base + 1)));
+		sqlite3_bind_int(insert, index++, piece_type_from_text(column_text(select, base + 2)));
+		// rotation, position, meter, attack, damage received and spun were integers already
+		for(int column = base + 3; column < base + 10; column++)
+			sqlite3_bind_int(insert, index++, sqlite3_column_int(select, column));
+
+		u8 queue[5];
+		for(int i = 0; i < 5; i++)
+			queue[i] = piece_type_from_text(column_text(select, base + 10 + i));
+		sqlite3_bind_int(insert, index++, pack_queue(queue));
+		sqlite3_bind_int(insert, index++, piece_type_from_text(column_text(select, base + 15)));
+	}
+}
+
+// v2 rows only differ in their boards, they are rewritten in place a batch of games at a time
+// v2 never stored the rows above the visible 20, they come out empty, so verify-replay can flag those games
+// a stopped upgrade picks up where it left off, boards that are already current stay as they are
+void upgrade_boards(sqlite3* db, int games_per_batch) {
+	if(sqlite3_create_function(db, "current_board", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, nullptr, current_board_function, nullptr, nullptr) != SQLITE_OK)
+		throw std::runtime_error("couldnt register current_board: " + std::string(sqlite3_errmsg(db)));
+
+	const sqlite3_int64 total_games = query_int(db, "SELECT COUNT(DISTINCT game_id) FROM Data;");
+	std::cout << total_games << " games to upgrade" << std::endl;
+
+	sqlite3_stmt* batch_end = prepare(db, "SELECT MAX(game_id) FROM (SELECT DISTINCT game_id FROM Data WHERE game_id > ? ORDER BY game_id LIMIT ?);");
+	sqlite3_stmt* update = prepare(db, "UPDATE Data SET p1_board = current_board(p1_board), p2_board = current_board(p2_board) WHERE game_id > ? AND game_id <= ?;");
+
+	const auto start = std::chrono::steady_clock::now();
+	sqlite3_int64 last_game = std::numeric_limits<sqlite3_int64>::min();
+	sqlite3_int64 games_done = 0;
+
+	try {
+		while(true) {
+			sqlite3_bind_int64(batch_end, 1, last_game);
+			sqlite3_bind_int(batch_end, 2, games_per_batch);
+			const bool has_rows = sqlite3_step(batch_end) == SQLITE_ROW && sqlite3_column_type(batch_end, 0) != SQLITE_NULL;
+			const sqlite3_int64 batch_last = has_rows ? sqlite3_column_int64(batch_end, 0) : 0;
+			sqlite3_reset(batch_end);
+			if(!has_rows)
+				break;
+
+			exec(db, "BEGIN");
+			sqlite3_bind_int64(update, 1, last_game);
+			sqlite3_bind_int64(update, 2, batch_last);
+			if(sqlite3_step(update) != SQLITE_DONE)
+				throw std::runtime_error("update error: " + std::string(sqlite3_errmsg(db)));
+			sqlite3_reset(update);
+			exec(db, "COMMIT");
+
+			last_game = batch_last;
+			games_done = std::min(games_done + games_per_batch, total_games);
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "\r" << games_done << " / " << total_games << " games, " << int(games_done / std::max(seconds, 1e-6)) << " games/s" << std::flush;
+		}
+	} catch(...) {
+		sqlite3_reset(update);
+		sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+		sqlite3_finalize(batch_end);
+		sqlite3_finalize(update);
+		throw;
+	}
+	std::cout << std::endl;
+
+	sqlite3_finalize(batch_end);
+	sqlite3_finalize(update);
+
+	exec(db, "PRAGMA user_version = " + std::to_string(data_schema_version) + ";");
+	exec(db, "PRAGMA wal_checkpoint(TRUNCATE);");
+	std::cout << "done, schema v" << data_schema_version << std::endl;
+}
+
+// moves the games over a batch at a time, each batch is one transaction that inserts into Data_v2 and deletes from Data
+// so the pages freed by a batch are reused by the next and a stopped migration picks up where it left off
+void migrate(sqlite3* db, int games_per_batch) {
+	exec(db,
+		"PRAGMA journal_mode = WAL;"
+		"PRAGMA synchronous = NORMAL;"
+		"PRAGMA temp_store = MEMORY;"
+		"PRAGMA cache_size = -65536;");
+
+	const sqlite3_int64 version = query_int(db, "PRAGMA user_version;");
+	const bool has_data = query_int(db, "SELECT EXISTS (SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'Data');") != 0;
+
+	if(version >= data_schema_version) {
+		std::cout << "already at schema v" << version << std::endl;
+		return;
+	}
+	if(!has_data) {
+		std::cout << "no Data table, nothing to migrate" << std::endl;
+		return;
+	}
+	if(version == 2) {
+		upgrade_boards(db, games_per_batch);
+		return;
+	}
+
+	exec(db, create_data_table_sql("Data_v2"));
+
+	const sqlite3_int64 total_rows = query_int(db, "SELECT COUNT(*) FROM Data;");
+	std::cout << total_rows << " rows left to migrate" << std::endl;
+
+	// the last game id of the next batch
+	sqlite3_stmt* batch_end = prepare(db, "SELECT MAX(game_id) FROM (SELECT DISTINCT game_id FROM Data ORDER BY game_id LIMIT ?);");
+	sqlite3_stmt* select = prepare(db, v1_select_sql());
+	sqlite3_stmt* insert = prepare(db, insert_data_sql("Data_v2"));
+	sqlite3_stmt* remove = prepare(db, "DELETE FROM Data WHERE game_id <= ?;");
+
+	const auto start = std::chrono::steady_clock::now();
+	sqlite3_int64 rows_done = 0;
+
+	try {
+		while(true) {
+			sqlite3_bind_int(batch_end, 1, games_per_batch);
+			const bool has_rows = sqlite3_step(batch_end) == SQLITE_ROW && sqlite3_column_type(batch_end, 0) != SQLITE_NULL;
+			const sqlite3_int64 last_game = has_rows ? sqlite3_column_int64(batch_end, 0) : 0;
+			sqlite3_reset(batch_end);
+			if(!has_rows)
+				break;
+
+			exec(db, "BEGIN");
+
+			sqlite3_bind_int64(select, 1, last_game);
+			int rc;
+			while((rc = sqlite3_step(select)) == SQLITE_ROW) {
+				convert_row(select, insert);
+				if(sqlite3_step(insert) != SQLITE_DONE)
+					throw std::runtime_error("insert error: " + std::string(sqlite3_errmsg(db)));
+				sqlite3_reset(insert);
+				rows_done++;
+			}
+			sqlite3_reset(select);
+			if(rc != SQLITE_DONE)
+				throw std::runtime_error("select error: " + std::string(sqlite3_errmsg(db)));
+
+			sqlite3_bind_int64(remove, 1, last_game);
+			if(sqlite3_step(remove) != SQLITE_DONE)
+				throw std::runtime_error("delete error: " + std::string(sqlite3_errmsg(db)));
+			sqlite3_reset(remove);
+
+			exec(db, "COMMIT");
+
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "\r" << rows_done << " / " << total_rows << " rows, " << int(rows_done / std::max(seconds, 1e-6)) << " rows/s" << std::flush;
+		}
+	} catch(...) {
+		sqlite3_reset(select);
+		sqlite3_reset(insert);
+		sqlite3_reset(remove);
+		sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+		sqlite3_finalize(batch_end);
+		sqlite3_finalize(select);
+		sqlite3_finalize(insert);
+		sqlite3_finalize(remove);
+		throw;
+	}
+	std::cout << std::endl;
+
+	sqlite3_finalize(batch_end);
+	sqlite3_finalize(select);
+	sqlite3_finalize(insert);
+	sqlite3_finalize(remove);
+
+	// swapping the tables and the version together, a database is never half way between the two
+	exec(db,
+		"BEGIN;"
+		"DROP TABLE Data;"
+		"ALTER TABLE Data_v2 RENAME TO Data;"
+		"PRAGMA user_version = " + std::to_string(data_schema_version) + ";"
+		"COMMIT;");
+
+	// the free pages left behind by the wider rows go back to the file system
+	std::cout << "vacuuming" << std::endl;
+	exec(db, "VACUUM;");
+	exec(db, "PRAGMA wal_checkpoint(TRUNCATE);");
+	std::cout << "done, schema v" << data_schema_version << std::endl;
+}
+
+// one pass over the Data table in primary key order, straight into the mapped output
+void export_columnar(sqlite3* db, const std::filesystem::path& output) {
+	if(query_int(db, "PRAGMA user_version;") != data_schema_version)
+		throw std::runtime_error("the database is not at schema v" + std::to_string(data_schema_version) + ", migrate it first");
+
+	const sqlite3_int64 position_count = query_int(db, "SELECT COUNT(*) FROM Data;");
+	const sqlite3_int64 game_count = query_int(db, "SELECT COUNT(DISTINCT game_id) FROM Data;");
+	columnar_writer writer(output, position_count, game_count);
+
+	sqlite3_stmt* select = prepare(db, "SELECT * FROM Data ORDER BY game_id, move_index;");
+	const auto start = std::chrono::steady_clock::now();
+	sqlite3_int64 rows_done = 0;
+	sqlite3_int64 last_game = 0;
+
+	int rc;
+	while((rc = sqlite3_step(select)) == SQLITE_ROW) {
+		const sqlite3_int64 game_id = sqlite3_column_int64(select, 0);
+		if(rows_done == 0 || game_id != last_game)
+			writer.begin_game(game_id);
+		last_game = game_id;
+
+		game_state_datum_v2 players[2];
+		for(int p = 0; p < 2; p++) {
+			const int base = 3 + p * 12;
+			game_state_datum_v2& d = players[p];
+			if(sqlite3_column_bytes(select, base) != (int)d.board.bytes.size())
+				throw std::runtime_error("board blob of " + std::to_string(sqlite3_column_bytes(select, base)) + " bytes");
+			std::memcpy(d.board.bytes.data(), sqlite3_column_blob(select, base), d.board.bytes.size());
+			d.p_type = (u8)sqlite3_column_int(select, base + 1);
+			d.m_type = (u8)sqlite3_column_int(select, base + 2);
+			d.m_rot = (u8)sqlite3_column_int(select, base + 3);
+			d.m_x = (u8)sqlite3_column_int(select, base + 4);
+			d.m_y = (u8)sqlite3_column_int(select, base + 5);
+			d.meter = (u8)sqlite3_column_int(select, base + 6);
+			d.attack = (u8)sqlite3_column_int(select, base + 7);
+			d.damage_received = (u8)sqlite3_column_int(select, base + 8);
+			d.spun = (u8)sqlite3_column_int(select, base + 9);
+			unpack_queue(sqlite3_column_int(select, base + 10), d.queue);
+			d.hold = (u8)sqlite3_column_int(select, base + 11);
+		}
+		writer.add((u8)sqlite3_column_int(select, 2), players[0], players[1]);
+
+		if(++rows_done % 100000 == 0) {
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::cout << "\r" << rows_done << " / " << position_count << " rows, " << int(rows_done / std::max(seconds, 1e-6)) << " rows/s" << std::flush;
+		}
+	}
+	sqlite3_finalize(select);
+	if(rc != SQLITE_DONE)
+		throw std::runtime_error("select error: " + std::string(sqlite3_errmsg(db)));
+
+	writer.finish();
+	std::cout << "\r" << rows_done << " positions in " << game_count << " games written to " << output.string() << std::endl;
+}
+
+// a replay is only worth archiving the database for if it rebuilds what the database has
+// returns the number of games that dont match
+size_t verify_replay(sqlite3* db, const std::filesystem::path& path) {
+	if(query_int(db, "PRAGMA user_version;") != data_schema_version)
+		throw std::runtime_error("the database is not at schema v" + std::to_string(data_schema_version) + ", migrate it first");
+
+	const replay_reader replay(path);
+	if(replay.get_trailing_bytes() > 0)
+		std::cout << replay.get_trailing_bytes() << " bytes at the end of the replay are not a whole game" << std::endl;
+
+	sqlite3_stmt* select = prepare(db, "SELECT * FROM Data WHERE game_id = ? ORDER BY move_index;");
+	const auto start = std::chrono::steady_clock::now();
+	size_t positions = 0;
+	size_t bad_games = 0;
+
+	for(size_t game = 0; game < replay.game_count(); game++) {
+		const replay_game_header header = replay.game_header(game);
+		sqlite3_bind_int64(select, 1, header.game_id);
+
+		size_t rows = 0;
+		bool matches = true;
+		replay.play(game, [&](size_t turn, const VersusGame& versus) {
+			if(!matches || sqlite3_step(select) != SQLITE_ROW || sqlite3_column_int(select, 1) != (int)turn) {
+				matches = false;
+				return;
+			}
+			rows++;
+
+			// the last row is written at the end of the game, the rest before the turn is played
+			const bool last = turn == header.turns;
+			if(last && sqlite3_column_int(select, 2) != (int)versus.state)
+				matches = false;
+
+			const Game* players[2] = { &versus.p1_game, &versus.p2_game };
+			for(int p = 0; p < 2; p++) {
+				const int base = 3 + p * 12;
+				const Game& player = *players[p];
+				const packed_board board = pack_board(player.board);
+				u8 queue[5];
+				for(int i = 0; i < 5; i++)
+					queue[i] = (u8)player.queue[i];
+				const int hold = player.hold ? (int)player.hold->type : 7;
+
+				if(sqlite3_column_bytes(select, base) != (int)board.bytes.size()
+					|| std::memcmp(sqlite3_column_blob(select, base), board.bytes.data(), board.bytes.size()) != 0
+					|| sqlite3_column_int(select, base + 1) != (int)player.current_piece.type
+					|| sqlite3_column_int(select, base + 10) != pack_queue(queue)
+					|| sqlite3_column_int(select, base + 11) != hold)
+					matches = false;
+
+				if(!last) {
+					const packed_move move = replay.moves(game)[2 * turn + p];
+					if(sqlite3_column_int(select, base + 2) != move.type() || sqlite3_column_int(select, base + 3) != move.rot()
+						|| sqlite3_column_int(select, base + 4) != move.x() || sqlite3_column_int(select, base + 5) != move.y())
+						matches = false;
+				}
+			}
+		});
+		if(matches && sqlite3_step(select) != SQLITE_DONE)
+			matches = false;
+		sqlite3_reset(select);
+
+		positions += rows;
+		if(!matches) {
+			bad_games++;
+			std::cout << "game " << header.game_id << " doesnt match the database" << std::endl;
+		}
+	}
+	sqlite3_finalize(select);
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << replay.game_count() << " games, " << positions << " positions rebuilt in " << seconds << "s, "
+		<< bad_games << " games dont match" << std::endl;
+	return bad_games;
+}
+
+int main(int argc, char* argv[]) {
+	std::span<char*> args(argv, argc);
+	const std::string_view command = args.size() > 1 ? args[1] : "";
+	if(!(command == "migrate" && args.size() >= 3) && !((command == "export" || command == "verify-replay") && args.size() >= 4)) {
+		const auto name = std::filesystem::path(args[0]).filename();
+		std::cerr << "Usage: " << name << " migrate <database> <optional:games_per_batch>\n"
+			<< "       " << name << " export <database> <output>\n"
+			<< "       " << name << " verify-replay <database> <replay>" << std::endl;
+		return 1;
+	}
+
+	int games_per_batch = default_games_per_batch;
+	if(command == "migrate" && args.size() > 3) {
+		try {
+			games_per_batch = std::stoi(args[3]);
+		} catch(const std::exception&) {
+			games_per_batch = 0;
+		}
+		if(games_per_batch <= 0) {
+			std::cerr << "games_per_batch must be a number, 1 or more" << std::endl;
+			return 1;
+		}
+	}
+
+	sqlite3* db = nullptr;
+	const int flags = command == "migrate" ? SQLITE_OPEN_READWRITE : SQLITE_OPEN_READONLY;
+	if(sqlite3_open_v2(args[2], &db, flags, nullptr) != SQLITE_OK) {
+		std::cerr << "couldnt open the database: " << args[2] << ", " << sqlite3_errmsg(db) << std::endl;
+		sqlite3_close(db);
+		return 1;
+	}
+
+	if(command == "export") {
+		try {
+			export_columnar(db, args[3]);
+		} catch(const std::exception& e) {
+			std::cerr << "\nexport failed: " << e.what() << std::endl;
+			sqlite3_close(db);
+			return 1;
+		}
+		sqlite3_close(db);
+		return 0;
+	}
+
+	if(command == "verify-replay") {
+		size_t bad_games = 0;
+		try {
+			bad_games = verify_replay(db, args[3]);
+		} catch(const std::exception& e) {
+			std::cerr << "verify failed: " << e.what() << std::endl;
+			sqlite3_close(db);
+			return 1;
+		}
+		sqlite3_close(db);
+		return bad_games == 0 ? 0 : 1;
+	}
+
+	try {
+		migrate(db, games_per_batch);
+	} catch(const std::exception& e) {
+		std::cerr << "\nmigration stopped: " << e.what() << "\nrun it again to carry on from the last finished batch" << std::endl;
+		sqlite3_close(db);
+		return 1;
+	}
+
+	sqlite3_close(db);
+	return 0;
+}
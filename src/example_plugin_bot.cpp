@@ -0,0 +1,129 @@
+// an example bot plugin, loads into the stadium in process through uts_bot_plugin.h
+// it plays greedily, each move clears the most lines it can while keeping the stack low and without holes
+// build it with the example_plugin_bot target and give the stadium the path of the library as the bot
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <optional>
+
+#include "Game.hpp"
+#include "uts_bot_plugin.h"
+
+namespace {
+
+struct ExampleBot {
+    Board board;
+    // the current piece first
+    std::deque<PieceType> queue;
+    std::optional<PieceType> hold;
+    // kept between suggests so movegen never allocates
+    Game::PlacementBuffer placements;
+};
+
+uint16_t pack_move(const Piece& piece) {
+    return uint16_t(u16(piece.type) | u16(piece.rotation) << 3 | u16(piece.position.x) << 5 | u16(piece.position.y) << 9 |
+                    u16(piece.spin) << 14);
+}
+
+Piece unpack_move(uint16_t move) {
+    return Piece(PieceType(move & 7), Coord{ int8_t(move >> 5 & 15), int8_t(move >> 9 & 31) }, RotationDirection(move >> 3 & 3),
+                 spinType(move >> 14 & 3));
+}
+
+void copy_name(char (&to)[64], const char* from) {
+    std::strncpy(to, from, sizeof(to) - 1);
+    to[sizeof(to) - 1] = '\0';
+}
+
+} // namespace
+
+extern "C" {
+
+UTS_BOT_EXPORT uint32_t uts_bot_abi_version(void) {
+    return UTS_BOT_PLUGIN_ABI_VERSION;
+}
+
+UTS_BOT_EXPORT void* uts_bot_create(uts_bot_info* info) {
+    copy_name(info->name, "example plugin bot");
+    copy_name(info->author, "uts");
+    copy_name(info->version, "1.0");
+    return new ExampleBot();
+}
+
+UTS_BOT_EXPORT void uts_bot_destroy(void* bot) {
+    delete static_cast<ExampleBot*>(bot);
+}
+
+UTS_BOT_EXPORT void uts_bot_start(void* instance, const uts_player_state* self, const uts_player_state*) {
+    ExampleBot& bot = *static_cast<ExampleBot*>(instance);
+    bot.board = Board();
+    for (int x = 0; x < UTS_BOARD_WIDTH; x++)
+        for (int y = 0; y < UTS_BOARD_HEIGHT; y++)
+            if (self->board[x] >> y & 1)
+                bot.board.set(x, y);
+
+    bot.queue.clear();
+    for (int i = 0; i < self->queue_length; i++)
+        bot.queue.push_back(PieceType(self->queue[i]));
+    bot.hold.reset();
+    if (self->hold != UTS_PIECE_NONE)
+        bot.hold = PieceType(self->hold);
+}
+
+UTS_BOT_EXPORT int32_t uts_bot_suggest(void* instance, uint16_t* moves, int32_t capacity) {
+    ExampleBot& bot = *static_cast<ExampleBot*>(instance);
+    if (bot.queue.empty() || capacity < 1)
+        return 0;
+
+    Game game;
+    game.board = bot.board;
+    bot.placements.clear();
+    game.movegen(bot.queue.front(), bot.placements);
+    // holding swaps in the held piece, or the next one when nothing is held yet
+    const std::optional<PieceType> other = bot.hold ? bot.hold : bot.queue.size() > 1 ? std::optional(bot.queue[1]) : std::nullopt;
+    if (other && *other != bot.queue.front())
+        game.movegen(*other, bot.placements);
+
+    const Piece* best = nullptr;
+    int best_score = INT32_MIN;
+    for (const Piece& piece : bot.placements) {
+        Board board = bot.board;
+        board.set(piece);
+        const int lines = board.clearLines();
+        const BoardFeatures features = board.features();
+        const int score = lines * 64 - features.max_height * 4 - features.holes * 8;
+        if (score > best_score) {
+            best_score = score;
+            best = &piece;
+        }
+    }
+    if (!best)
+        return 0;
+    moves[0] = pack_move(*best);
+    return 1;
+}
+
+UTS_BOT_EXPORT void uts_bot_play(void* instance, uint16_t move, const uts_player_state*) {
+    ExampleBot& bot = *static_cast<ExampleBot*>(instance);
+    const Piece piece = unpack_move(move);
+
+    const PieceType current = bot.queue.front();
+    bot.queue.pop_front();
+    if (piece.type != current) {
+        // the first hold takes the next piece out of the queue, later ones swap with the held piece
+        if (!bot.hold)
+            bot.queue.pop_front();
+        bot.hold = current;
+    }
+
+    bot.board.set(piece);
+    bot.board.clearLines();
+}
+
+UTS_BOT_EXPORT void uts_bot_new_piece(void* instance, uint8_t piece) {
+    static_cast<ExampleBot*>(instance)->queue.push_back(PieceType(piece));
+}
+
+UTS_BOT_EXPORT void uts_bot_stop(void*) {}
+}
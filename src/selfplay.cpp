@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EngineCheck.hpp"
+#include "SelfPlay.hpp"
+
+// runs every engine cross check, the args after --verify are <optional:positions> <optional:seed>
+int verify(const std::vector<std::string>& vargs) {
+    size_t positions = 2000;
+    u32 seed = 0;
+    try {
+        if (vargs.size() > 1)
+            positions = std::stoull(vargs[1]);
+        seed = vargs.size() > 2 ? (u32)std::stoul(vargs[2]) : std::random_device()();
+    } catch (const std::exception&) {
+        std::cerr << "positions and seed must be numbers" << std::endl;
+        return 1;
+    }
+
+    EngineCheck check(positions, seed);
+    std::cout << "seed: " << seed << ", positions: " << check.position_count() << std::endl;
+
+    size_t total = 0;
+    auto run = [&total](const char* name, size_t mismatches) {
+        std::cout << name << ": " << (mismatches == 0 ? "ok" : std::to_string(mismatches) + " mismatches") << std::endl;
+        total += mismatches;
+    };
+    run("movegen bitboard vs bfs", check.movegen_engines());
+    run("movegen buffer vs vector", check.movegen_overloads());
+    run("apply and undo", check.apply_undo());
+    run("t spins vs corner scan", check.t_spins());
+
+    return total == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    // the args should look like this: ./a.out <games> <p1 policy> <p2 policy> <optional:threads> <optional:seed>
+    // --cache takes placements from a movegen cache shared by the threads and reports its hit rate
+    // --verify checks the fast paths of the engine against the reference ones instead of playing
+    std::span<char*> args(argv, argc);
+    std::vector<std::string> vargs(args.begin(), args.end());
+
+    const auto cache_flag = std::find(vargs.begin(), vargs.end(), "--cache");
+    const bool use_cache = cache_flag != vargs.end();
+    if (use_cache)
+        vargs.erase(cache_flag);
+
+    const auto verify_flag = std::find(vargs.begin(), vargs.end(), "--verify");
+    if (verify_flag != vargs.end()) {
+        vargs.erase(verify_flag);
+        return verify(vargs);
+    }
+
+    if (vargs.size() < 4) {
+        std::cerr << "Usage: " << std::filesystem::path(vargs[0]).filename() << " [--cache] <games> <p1 policy> <p2 policy> <optional:threads> <optional:seed>" << std::endl;
+        std::cerr << "       " << std::filesystem::path(vargs[0]).filename() << " --verify <optional:positions> <optional:seed>" << std::endl;
+        std::cerr << "policies: random, greedy" << std::endl;
+        return 1;
+    }
+
+    size_t games = 0;
+    unsigned int threads = 1;
+    u32 seed = 0;
+    try {
+        games = std::stoull(vargs[1]);
+        if (vargs.size() > 4)
+            threads = std::max(1, std::stoi(vargs[4]));
+        seed = vargs.size() > 5 ? (u32)std::stoul(vargs[5]) : std::random_device()();
+    } catch (const std::exception&) {
+        std::cerr << "games, threads and seed must be numbers" << std::endl;
+        return 1;
+    }
+
+    auto p1_policy = SelfPlay::policy_by_name(vargs[2]);
+    auto p2_policy = SelfPlay::policy_by_name(vargs[3]);
+    if (!p1_policy || !p2_policy) {
+        std::cerr << "unknown policy, use random or greedy" << std::endl;
+        return 1;
+    }
+
+    SelfPlay selfplay;
+
+    std::unique_ptr<MovegenCache> cache;
+    if (use_cache) {
+        cache = std::make_unique<MovegenCache>();
+        selfplay.movegen_cache = cache.get();
+    }
+
+    std::vector<SelfPlay::Stats> thread_stats(threads);
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned int i = 0; i < threads; i++) {
+        // spread the remainder over the first threads
+        size_t thread_games = games / threads + (i < games % threads ? 1 : 0);
+        workers.emplace_back([&, i, thread_games] {
+            thread_stats[i] = selfplay.play(thread_games, *p1_policy, *p2_policy, seed + i);
+        });
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    SelfPlay::Stats stats;
+    for (const auto& s : thread_stats)
+        stats.merge(s);
+
+    std::cout << "seed: " << seed << "\n"
+        << "games: " << stats.games << " (" << threads << " threads, " << seconds << "s)\n"
+        << "Player 1 wins: " << stats.p1_wins << "\nPlayer 2 wins: " << stats.p2_wins << "\nDraws: " << stats.draws << "\nUnfinished: " << stats.unfinished << "\n"
+        << "turns: " << stats.turns << ", moves: " << stats.moves << "\n"
+        << "games/s: " << stats.games / seconds << "\n"
+        << "turns/s: " << stats.turns / seconds << "\n"
+        << "moves/s: " << stats.moves / seconds << std::endl;
+
+    if (use_cache) {
+        const size_t lookups = stats.cache.hits + stats.cache.misses;
+        std::cout << "movegen cache hits: " << stats.cache.hits << " / " << lookups << " ("
+            << (lookups ? 100.0 * stats.cache.hits / lookups : 0.0) << "%)" << std::endl;
+    }
+
+    return 0;
+}
@@ -1,46 +1,91 @@
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <csignal>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <iostream>
+#include <optional>
+#include <random>
 #include <span>
+#include <sstream>
+#include <string>
 #include <thread>
+#include <vector>
 #include <cstdlib>
 
 #include "Bot.hpp"
+#include "BotPool.hpp"
 #include "Dataset/GameState.hpp"
+#include "Dataset/Replay.hpp"
+#include "Dataset/Schema.hpp"
 #include "VersusGame.hpp"
+#include "bounded_queue.hpp"
+#include "latency_histogram.hpp"
 
 #include "sqlite3.h"
 
 #include <algorithm>
 
-void push_state(sqlite3* db, VersusGame::State& state, game_state_datum& p1, game_state_datum& p2, sqlite3_int64 game_uuid, int move_index);
+void push_state(sqlite3* db, const VersusGame::State& state, const game_state_datum_v2& p1, const game_state_datum_v2& p2, sqlite3_int64 game_uuid, int move_index);
 
-game_state_datum make_data(const Game& game, const Move& move, int damage_sent);
+void push_latency(sqlite3* db, sqlite3_int64 game_uuid, const LatencyHistogram& p1, const LatencyHistogram& p2);
+
+game_state_datum_v2 make_data(const Game& game, const Move& move, int damage_sent);
 struct game_state {
 	VersusGame::State state;
-	game_state_datum p1;
-	game_state_datum p2;
+	game_state_datum_v2 p1;
+	game_state_datum_v2 p2;
 	sqlite3_int64 game_uuid;
 	int move_index;
 };
 
-enum class State {
-	PLAYING,
-	SETUP,
-	GAME_OVER,
+// everything saved about one game, handed to the writer thread in one piece
+struct finished_game {
+	std::vector<game_state> states;
+	sqlite3_int64 game_uuid;
+	LatencyHistogram p1_latency;
+	LatencyHistogram p2_latency;
+	replay_game replay;
+	std::string p1_bot;
+	std::string p2_bot;
+	VersusGame::State result;
+	int turns;
 };
 
+void write_game(sqlite3* db, const finished_game& game, replay_writer* replay_file);
+
 sqlite3* database{ nullptr };
 sqlite3_stmt* stmt = nullptr;
+// prepared the first time they are used, close_database finalizes them with stmt
+sqlite3_stmt* next_game_id_stmt = nullptr;
+sqlite3_stmt* latency_stmt = nullptr;
+sqlite3_stmt* game_stmt = nullptr;
+
+// sqlite wont close a connection that still has prepared statements, and only a closed one checkpoints and removes the WAL
+bool close_database() {
+	for(sqlite3_stmt** statement : { &stmt, &next_game_id_stmt, &latency_stmt, &game_stmt }) {
+		sqlite3_finalize(*statement);
+		*statement = nullptr;
+	}
+	if(sqlite3_close(database) != SQLITE_OK) {
+		fprintf(stderr, "couldnt close the database: %s\n", sqlite3_errmsg(database));
+		return false;
+	}
+	database = nullptr;
+	return true;
+}
+
+// set by ctrl+c, the match loop stops and the games that are done get written before exiting
+std::atomic<bool> stop_requested{ false };
 
 bool init_stmt(sqlite3* db) {
-	const char* stmt_str = "INSERT INTO Data (game_id, move_index, state,p1_board,p1_current_piece,p1_move_piece_type,p1_move_piece_rot,p1_move_piece_x,p1_move_piece_y,p1_meter,p1_attack,p1_damage_received,p1_spun,p1_queue_0,p1_queue_1,p1_queue_2,p1_queue_3,p1_queue_4,p1_hold,p2_board,p2_current_piece,p2_move_piece_type,p2_move_piece_rot,p2_move_piece_x,p2_move_piece_y,p2_meter,p2_attack,p2_damage_received,p2_spun,p2_queue_0,p2_queue_1,p2_queue_2,p2_queue_3,p2_queue_4,p2_hold) VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?);";
+	const std::string stmt_str = insert_data_sql("Data");
 
-	int ret = sqlite3_prepare(db, stmt_str, -1, &stmt, nullptr);
+	int ret = sqlite3_prepare_v3(db, stmt_str.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
 	if(ret != SQLITE_OK) {
 		fprintf(stderr, "Failed to prepare statement: %s\n", sqlite3_errmsg(db));
 		return false;
@@ -49,51 +94,115 @@ bool init_stmt(sqlite3* db) {
 	return true;
 };
 
-bool create_table(sqlite3* db) {
+// write ahead logging so a commit is an append instead of a journal rewrite, and no fsync per commit
+// a crash can lose the last games but never corrupts the database
+bool configure_database(sqlite3* db) {
 	char* err_msg = 0;
 
-	// We use a multi-line string for clarity. 
-	// In C, adjacent string literals are automatically concatenated.
 	const char* sql =
-		"CREATE TABLE IF NOT EXISTS Data ("
-		"game_id INTEGER NOT NULL, "
-		"move_index INTEGER NOT NULL, "
-		"state TEXT NOT NULL, "
-		"p1_board BLOB NOT NULL, p1_current_piece TEXT NOT NULL, p1_move_piece_type TEXT NOT NULL, "
-		"p1_move_piece_rot INTEGER NOT NULL, p1_move_piece_x INTEGER NOT NULL, p1_move_piece_y INTEGER NOT NULL, "
-		"p1_meter INTEGER NOT NULL, p1_attack INTEGER NOT NULL, p1_damage_received INTEGER NOT NULL, "
-		"p1_spun INTEGER NOT NULL, "
-		"p1_queue_0 TEXT NOT NULL, p1_queue_1 TEXT NOT NULL, p1_queue_2 TEXT NOT NULL, p1_queue_3 TEXT NOT NULL, p1_queue_4 TEXT NOT NULL, "
-		"p1_hold TEXT NOT NULL, "
-		"p2_board BLOB NOT NULL, p2_current_piece TEXT NOT NULL, p2_move_piece_type TEXT NOT NULL, "
-		"p2_move_piece_rot INTEGER NOT NULL, p2_move_piece_x INTEGER NOT NULL, p2_move_piece_y INTEGER NOT NULL, "
-		"p2_meter INTEGER NOT NULL, p2_attack INTEGER NOT NULL, p2_damage_received INTEGER NOT NULL, "
-		"p2_spun INTEGER NOT NULL, "
-		"p2_queue_0 TEXT NOT NULL, p2_queue_1 TEXT NOT NULL, p2_queue_2 TEXT NOT NULL, p2_queue_3 TEXT NOT NULL, p2_queue_4 TEXT NOT NULL, "
-		"p2_hold TEXT NOT NULL, "
-		"PRIMARY KEY(game_id, move_index)"
-		");";
+		"PRAGMA page_size = 8192;"  // only takes effect on a new database
+		"PRAGMA journal_mode = WAL;"
+		"PRAGMA synchronous = NORMAL;"
+		"PRAGMA temp_store = MEMORY;"
+		"PRAGMA cache_size = -65536;";  // 64 MiB
 
-	// sqlite3_exec is the best choice for simple CREATE/DROP/DELETE commands
 	int rc = sqlite3_exec(db, sql, 0, 0, &err_msg);
 
+	if(rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error (Pragmas): %s\n", err_msg);
+		sqlite3_free(err_msg);
+		return false;
+	}
+	return true;
+}
+
+bool exec(sqlite3* db, const char* sql) {
+	char* err_msg = 0;
+	if(sqlite3_exec(db, sql, 0, 0, &err_msg) != SQLITE_OK) {
+		fprintf(stderr, "SQL error (%s): %s\n", sql, err_msg);
+		sqlite3_free(err_msg);
+		return false;
+	}
+	return true;
+}
+
+bool create_table(sqlite3* db) {
+	char* err_msg = 0;
+
+	// a Data table without user_version set is v1, it has to be migrated before games can be added to it
+	sqlite3_stmt* version_stmt = nullptr;
+	if(sqlite3_prepare_v2(db, "SELECT (SELECT user_version FROM pragma_user_version), EXISTS (SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'Data');", -1, &version_stmt, nullptr) != SQLITE_OK
+		|| sqlite3_step(version_stmt) != SQLITE_ROW) {
+		fprintf(stderr, "SQL error (Schema Version): %s\n", sqlite3_errmsg(db));
+		sqlite3_finalize(version_stmt);
+		return false;
+	}
+	const int version = sqlite3_column_int(version_stmt, 0);
+	const bool has_data = sqlite3_column_int(version_stmt, 1) != 0;
+	sqlite3_finalize(version_stmt);
+
+	if(has_data && version < data_schema_version) {
+		fprintf(stderr, "the database has schema v%d, run: dataset_tool migrate <database>\n", std::max(version, 1));
+		return false;
+	}
+	if(version > data_schema_version) {
+		fprintf(stderr, "the database has schema v%d, this build only knows up to v%d\n", version, data_schema_version);
+		return false;
+	}
+
+	const std::string sql = create_data_table_sql("Data") + "PRAGMA user_version = " + std::to_string(data_schema_version) + ";";
+
+	// sqlite3_exec is the best choice for simple CREATE/DROP/DELETE commands
+	int rc = sqlite3_exec(db, sql.c_str(), 0, 0, &err_msg);
+
 	if(rc != SQLITE_OK) {
 		fprintf(stderr, "SQL error (Create Table): %s\n", err_msg);
 		// We must free the error message allocated by sqlite3_exec
 		sqlite3_free(err_msg);
 		return false;
 	}
+
+	// suggestion round trips of both bots over a game, in microseconds
+	const char* latency_sql =
+		"CREATE TABLE IF NOT EXISTS GameLatency ("
+		"game_id INTEGER PRIMARY KEY, "
+		"p1_count INTEGER NOT NULL, p1_p50_us INTEGER NOT NULL, p1_p90_us INTEGER NOT NULL, p1_p99_us INTEGER NOT NULL, p1_max_us INTEGER NOT NULL, "
+		"p2_count INTEGER NOT NULL, p2_p50_us INTEGER NOT NULL, p2_p90_us INTEGER NOT NULL, p2_p99_us INTEGER NOT NULL, p2_max_us INTEGER NOT NULL"
+		");";
+
+	rc = sqlite3_exec(db, latency_sql, 0, 0, &err_msg);
+
+	if(rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error (Create Table): %s\n", err_msg);
+		sqlite3_free(err_msg);
+		return false;
+	}
+
+	// who played each game and how it ended, the bots are the paths they were started from
+	const char* games_sql =
+		"CREATE TABLE IF NOT EXISTS Games ("
+		"game_id INTEGER PRIMARY KEY, "
+		"p1_bot TEXT NOT NULL, p2_bot TEXT NOT NULL, "
+		"result INTEGER NOT NULL, turns INTEGER NOT NULL"
+		");";
+
+	rc = sqlite3_exec(db, games_sql, 0, 0, &err_msg);
+
+	if(rc != SQLITE_OK) {
+		fprintf(stderr, "SQL error (Create Table): %s\n", err_msg);
+		sqlite3_free(err_msg);
+		return false;
+	}
 	return true;
 }
 
 int get_next_game_id(sqlite3* db) {
-	// Static statement persists for the lifetime of the program
-	static sqlite3_stmt* stmt = nullptr;
+	sqlite3_stmt*& stmt = next_game_id_stmt;
 
 	// Initialize the statement only once
 	if(stmt == nullptr) {
 		const char* sql = "SELECT IFNULL(MAX(game_id), 0) + 1 FROM Data;";
-		int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
+		int rc = sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
 
 		if(rc != SQLITE_OK) {
 			auto err = std::string("Failed to prepare statement: ") + sqlite3_errmsg(db);
@@ -119,264 +228,607 @@ int get_next_game_id(sqlite3* db) {
 	return next_id;
 }
 
-void sigint_handler(int signal) {
-	printf("\n\nsaving progress so far...\n");
-	sqlite3_finalize(stmt);
-	sqlite3_close(database);
-	printf("saved!\n");
-	std::abort();
+void sigint_handler(int) {
+	// a second ctrl+c doesnt wait for the writer
+	if(stop_requested)
+		std::abort();
+	stop_requested = true;
+}
+
+// how long a bot gets to answer a suggest before it forfeits the game
+constexpr auto suggestion_timeout = std::chrono::seconds(5);
+
+// finished games that can wait for the writer before the match loop has to wait too, per worker
+constexpr size_t write_queue_capacity = 16;
+
+// how often the console is redrawn while games are played
+constexpr auto progress_interval = std::chrono::seconds(1);
+
+struct tournament_config {
+	std::vector<std::string> bots;
+	// games over all pairings, 0 plays until ctrl+c
+	long long games = 0;
+	int workers = 1;
+	// started instances kept per bot, 0 is one per worker
+	int pool_size = 0;
+	// pieces per second that the bots will play at, 0 plays as fast as the bots answer
+	float pps = 0.0f;
+	std::chrono::steady_clock::duration turn_period{ 0 };
+	std::string database_path = "database.db";
+	std::string replay_path;
+};
+
+// results of one pairing, player 1 is always the first bot of the pairing
+struct pairing_stats {
+	std::array<long long, 2> wins{};
+	long long draws = 0;
+	long long games = 0;
+	long long turns = 0;
+	// time spent in games, summed over the workers
+	std::chrono::steady_clock::duration play_time{ 0 };
+	LatencyHistogram p1_latency;
+	LatencyHistogram p2_latency;
+
+	void merge(const pairing_stats& other) {
+		wins[0] += other.wins[0];
+		wins[1] += other.wins[1];
+		draws += other.draws;
+		games += other.games;
+		turns += other.turns;
+		play_time += other.play_time;
+		p1_latency.merge(other.p1_latency);
+		p2_latency.merge(other.p2_latency);
+	}
+};
+
+// what one worker played, the main thread locks it to merge the stats of every worker for the console
+struct worker_stats {
+	std::mutex mutex;
+	std::vector<pairing_stats> pairings;
+};
+
+// every pair of bots plays, the games are split evenly between the pairings and handed out one at a time
+class match_schedule {
+public:
+	match_schedule(size_t bot_count, long long games) : unlimited(games == 0) {
+		for(size_t first = 0; first < bot_count; first++)
+			for(size_t second = first + 1; second < bot_count; second++)
+				pairings.push_back({ first, second });
+
+		remaining = std::make_unique<std::atomic<long long>[]>(pairings.size());
+		dropped = std::make_unique<std::atomic<bool>[]>(pairings.size());
+		for(size_t p = 0; p < pairings.size(); p++)
+			remaining[p] = games / (long long)pairings.size() + ((long long)p < games % (long long)pairings.size());
+	}
+
+	// takes a game of the preferred pairing, or of the next pairing that has games left
+	std::optional<size_t> claim(size_t preferred) {
+		for(size_t i = 0; i < pairings.size(); i++) {
+			const size_t p = (preferred + i) % pairings.size();
+			if(dropped[p])
+				continue;
+			if(unlimited || remaining[p].fetch_sub(1) > 0)
+				return p;
+		}
+		return std::nullopt;
+	}
+
+	// a pairing with a bot that cant be started gets no more games, the other pairings go on
+	void drop(size_t pairing) {
+		dropped[pairing] = true;
+	}
+
+	std::vector<std::pair<size_t, size_t>> pairings;
+
+private:
+	const bool unlimited;
+	std::unique_ptr<std::atomic<long long>[]> remaining;
+	std::unique_ptr<std::atomic<bool>[]> dropped;
+};
+
+// what the workers share, the writer thread is the only one that touches the database
+struct tournament_shared {
+	const tournament_config& config;
+	match_schedule& schedule;
+	bounded_queue<finished_game>& write_queue;
+	std::atomic<sqlite3_int64> next_game_id;
+	std::atomic<bool> writer_failed{ false };
+};
+
+// p50 / p90 / p99 / max in ms
+std::string latency_summary(const LatencyHistogram& latency) {
+	std::ostringstream out;
+	out << latency.percentile(0.5) / 1000.0 << " / " << latency.percentile(0.9) / 1000.0 << " / "
+		<< latency.percentile(0.99) / 1000.0 << " / " << latency.max() / 1000.0;
+	return out.str();
+}
+
+// plays one game on the two bots and queues it for the writer
+// returns false when the game was cut short by ctrl+c or the writer
+bool play_game(Bot& player_1, Bot& player_2, size_t pairing, tournament_shared& shared, worker_stats& stats) {
+	auto restart_bot_game = [](Bot& bot, Game& game, Game& opp) {
+		std::vector<PieceType> tbp_queue(Game::queue_size + 1);
+		tbp_queue[0] = game.current_piece.type;
+		for(size_t i = 0; i < Game::queue_size; i++) {
+			tbp_queue[i + 1] = game.queue[i];
+		}
+		bot.TBP_start(opp, game.board, tbp_queue, game.hold, game.stats.b2b != 0, game.stats.combo);
+	};
+
+	VersusGame game;
+	std::vector<game_state> game_states;
+	replay_game replay;
+	int move_index = 0;
+
+	// turns are due at fixed times from the start of the game, so the time spent in a turn counts towards the next one
+	auto next_turn = std::chrono::steady_clock::now();
+	auto game_start = next_turn;
+
+	auto setup = [&] {
+		// the seeds are kept so the game can be replayed from its moves
+		replay = {};
+		replay.p1_seed = std::random_device()();
+		replay.p2_seed = std::random_device()();
+		game = VersusGame(replay.p1_seed, replay.p2_seed);
+
+		// a game given up on half way is not saved
+		game_states.clear();
+		move_index = 0;
+
+		restart_bot_game(player_2, game.p2_game, game.p1_game);
+
+		restart_bot_game(player_1, game.p1_game, game.p2_game);
+
+		player_1.reset_game_latency();
+		player_2.reset_game_latency();
+
+		game_start = next_turn = std::chrono::steady_clock::now();
+	};
+	setup();
+
+	while(!game.game_over) {
+		if(stop_requested || shared.writer_failed)
+			return false;
+
+		// a bot that doesnt answer in time or disconnects loses the game
+		auto forfeit = [&game](int id) {
+			game.game_over = true;
+			game.state = id == 0 ? VersusGame::State::P2_WIN : VersusGame::State::P1_WIN;
+		};
+
+		// TBP bots think at the same time, a plugin thinks inside its TBP_suggest so the TBP bots are sent theirs first
+		// every bot is timed from its own suggest, a plugin thinking before it doesnt take from its time
+		std::array<Bot*, 2> players = { &player_1, &player_2 };
+		for(Bot* player : players) {
+			if(!player->is_plugin())
+				player->TBP_suggest();
+		}
+		for(Bot* player : players) {
+			if(player->is_plugin())
+				player->TBP_suggest();
+		}
+
+		const auto deadline = std::max(player_1.get_suggest_sent(), player_2.get_suggest_sent()) + suggestion_timeout;
+		Bot::wait_for_lines(players, deadline);
+
+		std::array<std::vector<Piece>, 2> suggestions;
+		bool forfeited = false;
+		for(int id = 0; id < 2; id++) {
+			BotStatus status = players[id]->TBP_suggestion(suggestions[id], suggestion_timeout);
+			if(status != BotStatus::Ok && !forfeited) {
+				std::cerr << "player " << id + 1 << " " << describe(status) << ", forfeiting" << std::endl;
+				forfeit(id);
+				forfeited = true;
+			}
+		}
+		if(forfeited)
+			break;
+
+		if(suggestions[0].empty() || suggestions[1].empty()) {
+			// this is a band-aid patch 
+			// the bot may have different death rules than what we have in our implementation which causes no moves to be returned
+			setup();
+			continue;
+		}
+
+		// bots list their moves most preferred first
+		Piece suggestion_1 = suggestions[0].front();
+		Piece suggestion_2 = suggestions[1].front();
+
+		game.p1_move.null_move = false;
+		game.p1_move.piece = suggestion_1;
+
+		bool p1_first_hold = false;
+		if(!game.p1_game.hold && suggestion_1.type != game.p1_game.current_piece.type) {
+			p1_first_hold = true;
+		}
+
+		bool p2_first_hold = false;
+		if(!game.p2_game.hold && suggestion_2.type != game.p2_game.current_piece.type) {
+			p2_first_hold = true;
+		}
+
+		game.p2_move.null_move = false;
+		game.p2_move.piece = suggestion_2;
+
+
+		game_state_datum_v2 p1(make_data(game.p1_game, game.p1_move, game.p1_damage_sent));
+		game_state_datum_v2 p2(make_data(game.p2_game, game.p2_move, game.p2_damage_sent));
+		VersusGame::State s = VersusGame::State::PLAYING;
+
+		game.play_moves();
+		replay.turns.push_back({ packed_move::pack(suggestion_1), packed_move::pack(suggestion_2) });
+
+		p1.attack = game.p1_damage_sent;
+		p1.damage_received = game.p2_damage_sent;
+		p1.spun = game.p1_spun;
+
+		p2.attack = game.p2_damage_sent;
+		p2.damage_received = game.p1_damage_sent;
+		p2.spun = game.p2_spun;
+
+		// save the data to file buffer
+		game_states.push_back({ s, p1, p2, 0, move_index });
+		move_index++;
+
+		bool p2_play = false;
+		if(game.p2_accepts_garbage) {
+			restart_bot_game(player_2, game.p2_game, game.p1_game);
+		} else {
+			if(p2_first_hold) {
+				player_2.TBP_new_piece(game.p2_game.queue[3]);
+			}
+			player_2.TBP_new_piece(game.p2_game.queue.back());
+			p2_play = true;
+		}
+
+		bool p1_play = false;
+		if(game.p1_accepts_garbage) {
+			restart_bot_game(player_1, game.p1_game, game.p2_game);
+		} else {
+			if(p1_first_hold)
+				player_1.TBP_new_piece(game.p1_game.queue[3]);
+			player_1.TBP_new_piece(game.p1_game.queue.back());
+
+			p1_play = true;
+		}
+
+		if(p2_play)
+			player_2.TBP_play(game.p2_game, suggestion_2);
+
+		if(p1_play)
+			player_1.TBP_play(game.p2_game, suggestion_1);
+
+		if(shared.config.turn_period.count() > 0) {
+			next_turn += shared.config.turn_period;
+			// a turn that ran over starts the schedule again instead of rushing the turns after it
+			next_turn = std::max(next_turn, std::chrono::steady_clock::now());
+			std::this_thread::sleep_until(next_turn);
+		}
+	}
+
+	Move empty_move;
+	game_state_datum_v2 p1(make_data(game.p1_game, empty_move, 0));
+	game_state_datum_v2 p2(make_data(game.p2_game, empty_move, 0));
+	game_states.push_back({ game.state, p1, p2, 0, move_index });
+
+	if(std::ranges::count_if(game_states, [](const auto& state) {return state.state != VersusGame::State::PLAYING; }) != 1) {
+		throw std::runtime_error("uh oh");
+	}
+
+	{
+		std::lock_guard lock(stats.mutex);
+		pairing_stats& results = stats.pairings[pairing];
+		if(game.state == VersusGame::State::P1_WIN)
+			results.wins[0]++;
+		else if(game.state == VersusGame::State::P2_WIN)
+			results.wins[1]++;
+		else if(game.state == VersusGame::State::DRAW)
+			results.draws++;
+		results.games++;
+		results.turns += move_index;
+		results.play_time += std::chrono::steady_clock::now() - game_start;
+		results.p1_latency.merge(player_1.get_game_latency());
+		results.p2_latency.merge(player_2.get_game_latency());
+	}
+
+	// the ids are handed out here, the database may not have the last game yet
+	const sqlite3_int64 game_uuid = shared.next_game_id++;
+	for(game_state& state : game_states)
+		state.game_uuid = game_uuid;
+	replay.game_id = game_uuid;
+	replay.result = game.state;
+
+	const auto& [first, second] = shared.schedule.pairings[pairing];
+	// one write so the lines of workers finishing together dont interleave
+	std::ostringstream report;
+	report << "game " << game_uuid << " think ms p50/p90/p99/max, player 1: " << latency_summary(player_1.get_game_latency())
+		<< ", player 2: " << latency_summary(player_2.get_game_latency()) << "\n";
+	std::cout << report.str() << std::flush;
+
+	finished_game finished{ std::move(game_states), game_uuid, player_1.get_game_latency(), player_2.get_game_latency(), std::move(replay),
+		shared.config.bots[first], shared.config.bots[second], game.state, move_index };
+
+	// only waits if the writer is a whole queue behind
+	return shared.write_queue.push(std::move(finished));
+}
+
+// plays the games the schedule gives it, the bots are leased from the pool for a game at a time
+// player 1 is always leased first and pairings have the lower index first, so two workers never wait on each other
+void run_worker(size_t id, tournament_shared& shared, BotPool& pool, worker_stats& stats) {
+	const auto& pairings = shared.schedule.pairings;
+	size_t preferred = id % pairings.size();
+
+	while(!stop_requested && !shared.writer_failed) {
+		const std::optional<size_t> pairing = shared.schedule.claim(preferred);
+		if(!pairing)
+			break;
+		preferred = *pairing;
+
+		const auto [first, second] = pairings[*pairing];
+		BotPool::Lease player_1;
+		BotPool::Lease player_2;
+		try {
+			player_1 = pool.acquire(first);
+			player_2 = pool.acquire(second);
+		} catch(const std::exception& e) {
+			// the pool closing still stops the worker
+			if(!pool.has_failed(first) && !pool.has_failed(second))
+				throw;
+			std::cerr << "dropping pairing " << first + 1 << " vs " << second + 1 << ": " << e.what() << std::endl;
+			shared.schedule.drop(*pairing);
+			continue;
+		}
+
+		if(!play_game(*player_1, *player_2, *pairing, shared, stats))
+			break;
+	}
+}
+
+void print_stats(const tournament_config& config, const match_schedule& schedule, const std::vector<pairing_stats>& merged, std::chrono::steady_clock::duration elapsed) {
+	auto bot_label = [&config](size_t bot) {
+		return std::to_string(bot + 1) + ":" + std::filesystem::path(config.bots[bot]).filename().string();
+	};
+	auto print_latency = [](const std::string& label, const LatencyHistogram& latency) {
+		std::cout << "  " << label << " think ms p50/p90/p99/max: " << latency_summary(latency) << std::endl;
+	};
+
+	long long games = 0;
+	long long turns = 0;
+	std::chrono::steady_clock::duration play_time{ 0 };
+	for(size_t p = 0; p < merged.size(); p++) {
+		const auto& [first, second] = schedule.pairings[p];
+		const pairing_stats& results = merged[p];
+		std::cout << bot_label(first) << " vs " << bot_label(second) << ": " << results.wins[0] << " - " << results.wins[1]
+			<< ", draws: " << results.draws << ", games: " << results.games << std::endl;
+		print_latency(bot_label(first), results.p1_latency);
+		print_latency(bot_label(second), results.p2_latency);
+		games += results.games;
+		turns += results.turns;
+		play_time += results.play_time;
+	}
+
+	const double seconds = std::chrono::duration<double>(elapsed).count();
+	std::cout << "Total games: " << games;
+	if(config.games > 0)
+		std::cout << " / " << config.games;
+	std::cout << ", " << games / std::max(seconds, 1e-9) * 60.0 << " games/min on " << config.workers << " workers" << std::endl;
+
+	// pps of a single match, the time every worker spent in games is summed
+	std::cout << "PPS: " << turns / std::max(std::chrono::duration<double>(play_time).count(), 1e-9) << " per match, target ";
+	if(config.pps > 0.0f)
+		std::cout << config.pps << std::endl;
+	else
+		std::cout << "unthrottled" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-	// the args should look like this: ./a.out <bot1> <bot2> <pps>
 	std::span<char*> args(argv, argc);
 	// push to vector
 	std::vector<std::string> vargs;
 	for(auto& arg : args) {
 		vargs.push_back(arg);
 	}
-	vargs = { "lmao", "E:/PC/temp/cc-tbp.exe", "E:/PC/temp/cc-tbp.exe", "12" };
-	// check if the args are correct
-	if(vargs.size() < 4) {
-		std::cerr << "Usage: " << std::filesystem::path(vargs[0]).filename() << " <bot1> <bot2> <pps> <optional:save_path>" << std::endl;
-		return 1;
-	}
 
-	// pieces per second that the bots will play at
-	float pps = 0.0f;
-	float seconds_per_piece = 0.0f;
-	double now = std::chrono::high_resolution_clock::now().time_since_epoch().count() / 1e9;
+	auto usage = [&vargs] {
+		const auto name = std::filesystem::path(vargs[0]).filename().string();
+		std::cerr << "Usage: " << name << " <bot1> <bot2> <pps, 0 for unthrottled> <optional:save_path> <optional:replay_path>\n"
+			<< "       " << name << " tournament [--games n] [--workers n] [--pool n] [--pps pps] [--db save_path] [--replay replay_path] <bot1> <bot2> [more bots]\n"
+			<< "a tournament plays every pair of bots, --games is spread over the pairs and 0 plays until ctrl+c, --workers defaults to half the cores\n"
+			<< "--pool is how many started instances of each bot are kept ready, one per worker by default" << std::endl;
+		return 1;
+	};
 
+	tournament_config config;
 	try {
-		pps = std::stof(vargs[3]);
-		seconds_per_piece = 1.0f / pps;
+		if(vargs.size() > 1 && vargs[1] == "tournament") {
+			config.workers = std::max(1u, std::thread::hardware_concurrency() / 2);
+			for(size_t i = 2; i < vargs.size(); i++) {
+				const std::string& arg = vargs[i];
+				const bool has_value = i + 1 < vargs.size();
+				if(arg == "--games" && has_value)
+					config.games = std::stoll(vargs[++i]);
+				else if(arg == "--workers" && has_value)
+					config.workers = std::stoi(vargs[++i]);
+				else if(arg == "--pool" && has_value)
+					config.pool_size = std::stoi(vargs[++i]);
+				else if(arg == "--pps" && has_value)
+					config.pps = std::stof(vargs[++i]);
+				else if(arg == "--db" && has_value)
+					config.database_path = vargs[++i];
+				else if(arg == "--replay" && has_value)
+					config.replay_path = vargs[++i];
+				else if(arg.starts_with("--"))
+					return usage();
+				else
+					config.bots.push_back(arg);
+			}
+		} else if(vargs.size() >= 4) {
+			// one match between two bots until ctrl+c
+			config.bots = { vargs[1], vargs[2] };
+			config.pps = std::stof(vargs[3]);
+			if(vargs.size() > 4)
+				config.database_path = vargs[4];
+			if(vargs.size() > 5)
+				config.replay_path = vargs[5];
+		} else {
+			return usage();
+		}
 	} catch(const std::exception&) {
-		std::cerr << "pps must be a number" << std::endl;
-		return 1;
+		return usage();
 	}
 
-	// player interfaces for the bots
-	Bot player_1;
-
-	// start the bot
-	player_1.start(vargs[1].c_str());
-
-	Bot player_2;
-
-	// start the bot
-	player_2.start(vargs[2].c_str());
+	if(config.bots.size() < 2 || config.games < 0 || config.workers < 1 || config.pool_size < 0) {
+		return usage();
+	}
+	if(config.pps < 0.0f) {
+		std::cerr << "pps must be a number, 0 or more" << std::endl;
+		return 1;
+	}
+	if(config.pps > 0.0f)
+		config.turn_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / config.pps));
 
-	// create the game
-	VersusGame game;
-	std::string binary_path = vargs.size() > 4 ? vargs[4] : "database.db";
+	const std::string& binary_path = config.database_path;
 
-	std::vector<game_state> game_states;
 	int sql_ret = sqlite3_open(binary_path.c_str(), &database);
 
 	if(sql_ret != SQLITE_OK) {
 		std::cout << "couldnt open the database: " << binary_path << ", " << sqlite3_errmsg(database) << std::endl;
-		sqlite3_close(database);
+		close_database();
+		return 1;
+	}
+
+	if(!configure_database(database)) {
+		close_database();
 		return 1;
 	}
 
 	if(!create_table(database)) {
-		sqlite3_finalize(stmt);
-		sqlite3_close(database);
+		close_database();
 		return 1;
 	}
 
 	if(!init_stmt(database)) {
 		std::cout << "couldnt prepare statement: " << sqlite3_errmsg(database) << std::endl;
-		sqlite3_finalize(stmt);
-		sqlite3_close(database);
+		close_database();
 		return 1;
 	}
-	std::signal(SIGINT, sigint_handler);
 
-	State game_state = State::SETUP;
-	int game_uuid = get_next_game_id(database);
-	int move_index = 0;
+	// the seeds and moves of every game, a much smaller record than the database that every position can be rebuilt from
+	std::optional<replay_writer> replay_file;
+	if(!config.replay_path.empty()) {
+		try {
+			replay_file.emplace(config.replay_path);
+		} catch(const std::exception& e) {
+			std::cout << "couldnt open the replay file: " << e.what() << std::endl;
+			close_database();
+			return 1;
+		}
+	}
 
-	// recorded stats
-	std::array<int, 2> num_wins = { 0, 0 };
-	int num_games = 0;
-	int num_draws = 0;
+	std::signal(SIGINT, sigint_handler);
+#ifdef __linux__
+	// a bot that dies would otherwise kill the stadium on the next write to it, the write fails with EPIPE instead
+	std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+	match_schedule schedule(config.bots.size(), config.games);
+
+	// games are written on their own thread so the next one can start while the last one is saved
+	// every worker hands its games to the one writer, sqlite only takes one writer at a time anyway
+	bounded_queue<finished_game> write_queue(write_queue_capacity * config.workers);
+	tournament_shared shared{ config, schedule, write_queue, get_next_game_id(database) };
+	std::atomic<long long> rows_written{ 0 };
+	std::atomic<long long> write_micros{ 0 };
+
+	std::thread writer([&] {
+		while(auto finished = write_queue.pop()) {
+			const auto write_start = std::chrono::steady_clock::now();
+			try {
+				write_game(database, *finished, replay_file ? &*replay_file : nullptr);
+			} catch(const std::exception& e) {
+				std::cerr << "couldnt save game " << finished->game_uuid << ": " << e.what() << std::endl;
+				exec(database, "ROLLBACK");
+				// stops the workers, there is no point playing games that cant be saved
+				shared.writer_failed = true;
+				write_queue.close();
+				break;
+			}
+			rows_written += finished->states.size();
+			write_micros += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - write_start).count();
+		}
+	});
+
+	std::vector<worker_stats> stats(config.workers);
+	for(worker_stats& worker : stats)
+		worker.pairings.resize(schedule.pairings.size());
+
+	// every bot is loaded once and reused for game after game
+	BotPool pool(config.bots, config.pool_size > 0 ? config.pool_size : config.workers);
+
+	std::atomic<int> workers_running{ config.workers };
+	std::vector<std::thread> workers;
+	for(int id = 0; id < config.workers; id++) {
+		workers.emplace_back([&, id] {
+			try {
+				run_worker(id, shared, pool, stats[id]);
+			} catch(const std::exception& e) {
+				std::cerr << "worker " << id << " stopped: " << e.what() << std::endl;
+			}
+			workers_running--;
+		});
+	}
 
-	auto restart_bot_game = [](Bot& bot, Game& game, Game& opp) {
-		std::vector<PieceType> tbp_queue(Game::queue_size + 1);
-		tbp_queue[0] = game.current_piece.type;
-		for(size_t i = 0; i < Game::queue_size; i++) {
-			tbp_queue[i + 1] = game.queue[i];
+	// merges what every worker has played so far
+	auto merge_stats = [&] {
+		std::vector<pairing_stats> merged(schedule.pairings.size());
+		for(worker_stats& worker : stats) {
+			std::lock_guard lock(worker.mutex);
+			for(size_t p = 0; p < merged.size(); p++)
+				merged[p].merge(worker.pairings[p]);
 		}
-		bot.TBP_start(opp, game.board, tbp_queue, game.hold, game.stats.b2b != 0, game.stats.combo);
+		return merged;
 	};
 
-	// add boolean for changing the value while debugging
-	bool running = true;
-	while(running) {
-		switch(game_state) {
-			case State::PLAYING:
-			{
-				if(game.game_over) {
-					game_state = State::GAME_OVER;
-
-					Move empty_move;
-					game_state_datum p1(make_data(game.p1_game, empty_move, 0));
-					game_state_datum p2(make_data(game.p2_game, empty_move, 0));
-					game_states.push_back({ game.state, p1, p2, game_uuid, move_index });
-					break;
-				}
-
-				// if need to move then ask the bots for moves
-				bool no_moves_returned = false;
-				Piece suggestion_1 = PieceType::Empty;
-				Piece suggestion_2 = PieceType::Empty;
+	const auto session_start = std::chrono::steady_clock::now();
+	auto next_print = session_start;
+	while(workers_running > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		if(std::chrono::steady_clock::now() < next_print)
+			continue;
+		next_print += progress_interval;
+
+		// clear console
+		std::cout << "\033[2J\033[1;1H";
+		print_stats(config, schedule, merge_stats(), std::chrono::steady_clock::now() - session_start);
+		if(write_micros > 0)
+			std::cout << "DB rows/s: " << rows_written * 1e6 / write_micros << ", " << write_queue.size() << " games waiting to be saved" << std::endl;
+	}
 
-				player_1.TBP_suggest();
-				auto p1_suggestions = player_1.TBP_suggestion();
+	for(std::thread& worker : workers)
+		worker.join();
 
-				if(p1_suggestions.empty()) {
-					// this is a band-aid patch 
-					// the bot may have different death rules than what we have in our implementation which causes no moves to be returned
-					game_state = State::SETUP;
-					break;
-				}
-
-				suggestion_1 = p1_suggestions.back();
-
-
-				player_2.TBP_suggest();
-				auto p2_suggestions = player_2.TBP_suggestion();
-				if(p2_suggestions.empty()) {
-					game_state = State::SETUP;
-					break;
-				}
-
-				suggestion_2 = p2_suggestions.back();
-
-
-				game.p1_move.null_move = false;
-				game.p1_move.piece = suggestion_1;
-
-				bool p1_first_hold = false;
-				if(!game.p1_game.hold && suggestion_1.type != game.p1_game.current_piece.type) {
-					p1_first_hold = true;
-				}
-
-				bool p2_first_hold = false;
-				if(!game.p2_game.hold && suggestion_2.type != game.p2_game.current_piece.type) {
-					p2_first_hold = true;
-				}
-
-				game.p2_move.null_move = false;
-				game.p2_move.piece = suggestion_2;
-
-
-				game_state_datum p1(make_data(game.p1_game, game.p1_move, game.p1_damage_sent));
-				game_state_datum p2(make_data(game.p2_game, game.p2_move, game.p2_damage_sent));
-				VersusGame::State s = VersusGame::State::PLAYING;
-
-				game.play_moves();
-
-				p1.attack = game.p1_damage_sent;
-				p1.damage_received = game.p2_damage_sent;
-				p1.spun = game.p1_spun;
-
-				p2.attack = game.p2_damage_sent;
-				p2.damage_received = game.p1_damage_sent;
-				p2.spun = game.p2_spun;
-
-				// save the data to file buffer
-				game_states.push_back({ s, p1, p2, game_uuid, move_index });
-				move_index++;
-
-				bool p2_play = false;
-				if(game.p2_accepts_garbage) {
-					restart_bot_game(player_2, game.p2_game, game.p1_game);
-				} else {
-					if(p2_first_hold) {
-						player_2.TBP_new_piece(game.p2_game.queue[3]);
-					}
-					player_2.TBP_new_piece(game.p2_game.queue.back());
-					p2_play = true;
-				}
-
-				bool p1_play = false;
-				if(game.p1_accepts_garbage) {
-					restart_bot_game(player_1, game.p1_game, game.p2_game);
-				} else {
-					if(p1_first_hold)
-						player_1.TBP_new_piece(game.p1_game.queue[3]);
-					player_1.TBP_new_piece(game.p1_game.queue.back());
-
-					p1_play = true;
-				}
-
-				if(p2_play)
-					player_2.TBP_play(game.p2_game, suggestion_2);
-
-				if(p1_play)
-					player_1.TBP_play(game.p2_game, suggestion_1);
-
-				// find out if its time to update the framecount
-				std::this_thread::sleep_until(std::chrono::steady_clock::now() + std::chrono::milliseconds(int(seconds_per_piece * 1000.0f)));
-			} break;
-
-			case State::SETUP:
-			{
-				game = VersusGame();
-
-				restart_bot_game(player_2, game.p2_game, game.p1_game);
-
-				restart_bot_game(player_1, game.p1_game, game.p2_game);
-
-				game_state = State::PLAYING;
-			} break;
-
-			case State::GAME_OVER:
-			{
-				if(game.state == VersusGame::State::P1_WIN)
-					num_wins[0]++;
-				else if(game.state == VersusGame::State::P2_WIN)
-					num_wins[1]++;
-				else if(game.state == VersusGame::State::DRAW)
-					num_draws++;
+	if(stop_requested)
+		std::cout << "\n\nsaving progress so far..." << std::endl;
 
-				num_games++;
-				// clear console
-				std::cout << "\033[2J\033[1;1H";
-				std::cout << "Player 1 wins: " << num_wins[0] << "\nPlayer 2 wins: " << num_wins[1] << "\nDraws: " << num_draws << "\nTotal games: " << num_games << std::endl;
-				for(auto& state : game_states) {
-					push_state(database, state.state, state.p1, state.p2, state.game_uuid, state.move_index);
-				}
-				game_uuid = get_next_game_id(database);
-				move_index = 0;
-				if(std::ranges::count_if(game_states, [](const auto& state) {return state.state != VersusGame::State::PLAYING; }) != 1) {
-					throw std::runtime_error("uh oh");
-				}
-				game_states.clear(); 
-				game_state = State::SETUP;
-			} break;
-
-		}  // end switch
-	}
+	// the writer finishes everything that was queued before it stops
+	write_queue.close();
+	writer.join();
+
+	std::cout << "\n";
+	print_stats(config, schedule, merge_stats(), std::chrono::steady_clock::now() - session_start);
 
 	std::cout << "Ended" << std::endl;
-	sqlite3_finalize(stmt);
-	sqlite3_close(database);
+	if(!close_database())
+		return 1;
 
 	return 0;
 }
 
-game_state_datum make_data(const Game& game, const Move& move, int damage_sent) {
-	game_state_datum d{};
+game_state_datum_v2 make_data(const Game& game, const Move& move, int) {
+	game_state_datum_v2 d{};
 
-	std::array<u8, 10 * 20> board{};
-	for(size_t x = 0; x < 10; x++)
-		for(size_t y = 0; y < 20; y++) {
-			board[x + y * 10] = game.board.get(x, y);
-		}
-	d.b = board;
+	d.board = pack_board(game.board);
 
 	d.p_type = (u8)game.current_piece.type;
 
@@ -397,20 +849,7 @@ game_state_datum make_data(const Game& game, const Move& move, int damage_sent)
 	return d;
 }
 
-const char* type_to_str(u8 type) {
-	return std::array{
-	"S",
-	"Z",
-	"J",
-	"L",
-	"T",
-	"O",
-	"I",
-	"NULL"
-	} .at(type);
-}
-
-void push_state(sqlite3* db, VersusGame::State& state, game_state_datum& p1, game_state_datum& p2, sqlite3_int64 game_uuid, int move_index) {
+void push_state(sqlite3* db, const VersusGame::State& state, const game_state_datum_v2& p1, const game_state_datum_v2& p2, sqlite3_int64 game_uuid, int move_index) {
 
 	/*
 	file_buffer.append_range(std::span((u8*)&game.state, sizeof(VersusGame::State))); // one byte
@@ -424,76 +863,23 @@ void push_state(sqlite3* db, VersusGame::State& state, game_state_datum& p1, gam
 	int index = 1;
 	int rv;
 
-	sqlite3_bind_int64(stmt, index, game_uuid);
-	index++;
-	sqlite3_bind_int(stmt, index, move_index);
-	index++;
-	sqlite3_bind_text(stmt, index, std::array{ "PLAYING","P1_WIN","P2_WIN","DRAW" } .at((size_t)state) , -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_blob(stmt, index, p1.b.data(), 200, SQLITE_TRANSIENT);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p1.p_type), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p1.m_type), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p1.m_rot);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p1.m_x);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p1.m_y);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p1.meter);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p1.attack);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p1.damage_received);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p1.spun);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p1.queue[0]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p1.queue[1]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p1.queue[2]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p1.queue[3]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p1.queue[4]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p1.hold), -1, SQLITE_STATIC);
-	index++;
-
-	sqlite3_bind_blob(stmt, index, p2.b.data(), 200, SQLITE_TRANSIENT);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p2.p_type), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p2.m_type), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p2.m_rot);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p2.m_x);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p2.m_y);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p2.meter);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p2.attack);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p2.damage_received);
-	index++;
-	sqlite3_bind_int(stmt, index, (int)p2.spun);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p2.queue[0]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p2.queue[1]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p2.queue[2]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p2.queue[3]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p2.queue[4]), -1, SQLITE_STATIC);
-	index++;
-	sqlite3_bind_text(stmt, index, type_to_str(p2.hold), -1, SQLITE_STATIC);
+	sqlite3_bind_int64(stmt, index++, game_uuid);
+	sqlite3_bind_int(stmt, index++, move_index);
+	sqlite3_bind_int(stmt, index++, (int)state);
+	for(const game_state_datum_v2* p : { &p1, &p2 }) {
+		sqlite3_bind_blob(stmt, index++, p->board.bytes.data(), (int)p->board.bytes.size(), SQLITE_TRANSIENT);
+		sqlite3_bind_int(stmt, index++, (int)p->p_type);
+		sqlite3_bind_int(stmt, index++, (int)p->m_type);
+		sqlite3_bind_int(stmt, index++, (int)p->m_rot);
+		sqlite3_bind_int(stmt, index++, (int)p->m_x);
+		sqlite3_bind_int(stmt, index++, (int)p->m_y);
+		sqlite3_bind_int(stmt, index++, (int)p->meter);
+		sqlite3_bind_int(stmt, index++, (int)p->attack);
+		sqlite3_bind_int(stmt, index++, (int)p->damage_received);
+		sqlite3_bind_int(stmt, index++, (int)p->spun);
+		sqlite3_bind_int(stmt, index++, pack_queue(p->queue));
+		sqlite3_bind_int(stmt, index++, (int)p->hold);
+	}
 
 	rv = sqlite3_step(stmt);
 
@@ -507,3 +893,76 @@ void push_state(sqlite3* db, VersusGame::State& state, game_state_datum& p1, gam
 
 	sqlite3_reset(stmt);
 }
+
+void push_latency(sqlite3* db, sqlite3_int64 game_uuid, const LatencyHistogram& p1, const LatencyHistogram& p2) {
+	if(latency_stmt == nullptr) {
+		const char* sql = "INSERT OR REPLACE INTO GameLatency (game_id, p1_count, p1_p50_us, p1_p90_us, p1_p99_us, p1_max_us, p2_count, p2_p50_us, p2_p90_us, p2_p99_us, p2_max_us) VALUES (?,?,?,?,?,?,?,?,?,?,?);";
+		if(sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &latency_stmt, nullptr) != SQLITE_OK) {
+			auto err = std::string("Failed to prepare statement: ") + sqlite3_errmsg(db);
+			std::cerr << err << std::endl;
+			throw std::runtime_error(err);
+		}
+	}
+
+	int index = 1;
+	sqlite3_bind_int64(latency_stmt, index++, game_uuid);
+	for(const LatencyHistogram* latency : { &p1, &p2 }) {
+		sqlite3_bind_int64(latency_stmt, index++, (sqlite3_int64)latency->count());
+		sqlite3_bind_int64(latency_stmt, index++, (sqlite3_int64)latency->percentile(0.5));
+		sqlite3_bind_int64(latency_stmt, index++, (sqlite3_int64)latency->percentile(0.9));
+		sqlite3_bind_int64(latency_stmt, index++, (sqlite3_int64)latency->percentile(0.99));
+		sqlite3_bind_int64(latency_stmt, index++, (sqlite3_int64)latency->max());
+	}
+
+	if(sqlite3_step(latency_stmt) != SQLITE_DONE) {
+		auto err = std::string("latency insert error: ") + sqlite3_errmsg(db);
+		std::cerr << err << std::endl;
+		throw std::runtime_error(err);
+	}
+
+	sqlite3_reset(latency_stmt);
+}
+
+void push_game(sqlite3* db, const finished_game& game) {
+	if(game_stmt == nullptr) {
+		const char* sql = "INSERT OR REPLACE INTO Games (game_id, p1_bot, p2_bot, result, turns) VALUES (?,?,?,?,?);";
+		if(sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &game_stmt, nullptr) != SQLITE_OK) {
+			auto err = std::string("Failed to prepare statement: ") + sqlite3_errmsg(db);
+			std::cerr << err << std::endl;
+			throw std::runtime_error(err);
+		}
+	}
+
+	sqlite3_bind_int64(game_stmt, 1, game.game_uuid);
+	sqlite3_bind_text(game_stmt, 2, game.p1_bot.c_str(), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(game_stmt, 3, game.p2_bot.c_str(), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_int(game_stmt, 4, (int)game.result);
+	sqlite3_bind_int(game_stmt, 5, game.turns);
+
+	if(sqlite3_step(game_stmt) != SQLITE_DONE) {
+		auto err = std::string("game insert error: ") + sqlite3_errmsg(db);
+		std::cerr << err << std::endl;
+		throw std::runtime_error(err);
+	}
+
+	sqlite3_reset(game_stmt);
+}
+
+// the whole game goes in one transaction, one commit instead of one per row
+// the replay is written before the commit, a game in the database always has its replay
+// a failed replay write throws with the transaction still open and the game isnt saved
+void write_game(sqlite3* db, const finished_game& game, replay_writer* replay_file) {
+	if(!exec(db, "BEGIN"))
+		throw std::runtime_error("couldnt begin a transaction");
+
+	for(const game_state& state : game.states) {
+		push_state(db, state.state, state.p1, state.p2, state.game_uuid, state.move_index);
+	}
+	push_latency(db, game.game_uuid, game.p1_latency, game.p2_latency);
+	push_game(db, game);
+	if(replay_file)
+		replay_file->write(game.replay);
+
+	if(!exec(db, "COMMIT"))
+		throw std::runtime_error("couldnt commit the game");
+}
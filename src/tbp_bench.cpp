@@ -0,0 +1,311 @@
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Game.hpp"
+#include "TBPReader.hpp"
+#include "TBPWriter.hpp"
+#include "json.hpp"
+
+// times TBPWriter and TBPReader against going through nlohmann::json the way Bot did before them
+// and checks on every position that both give the same bytes and every suggestion that both read the same moves
+
+namespace reference {
+
+static nlohmann::json piece_name(PieceType type) {
+    static constexpr const char* names[] = { "S", "Z", "J", "L", "T", "O", "I" };
+    if (u8(type) < 7)
+        return names[u8(type)];
+    throw std::runtime_error("invalid piece");
+}
+
+static nlohmann::json board_rows(const Board& board, int rows, int filled_rows) {
+    nlohmann::json json_board = nlohmann::json::array();
+    for (int y = 0; y < rows; ++y) {
+        nlohmann::json row = nlohmann::json::array();
+        for (int x = 0; x < Board::width; ++x) {
+            if (y < filled_rows && board.get(x, y))
+                row.push_back("G");
+            else
+                row.push_back(nullptr);
+        }
+        json_board.push_back(row);
+    }
+    return json_board;
+}
+
+static std::string start(const Game& opp, const Board& board, const std::vector<PieceType>& queue, std::optional<Piece> hold, bool back_to_back, int combo) {
+    nlohmann::json start;
+    start["type"] = "start";
+    if (hold.has_value())
+        start["hold"] = hold->type == PieceType::Empty ? nlohmann::json("I") : piece_name(hold->type);
+    else
+        start["hold"] = nullptr;
+
+    std::vector<std::string> queue_names;
+    for (PieceType type : queue)
+        queue_names.push_back(piece_name(type));
+    start["queue"] = queue_names;
+    start["combo"] = combo;
+    start["back_to_back"] = back_to_back;
+
+    // the board Bot sent went through an array of optional strings first, that is kept to time the same work
+    std::array<std::array<std::optional<std::string>, 40>, 10> cells;
+    for (int x = 0; x < Board::width; ++x)
+        for (int y = 0; y < Board::visual_height; ++y)
+            if (board.get(x, y))
+                cells[x][y] = "G";
+    start["board"] = nlohmann::json::array();
+    for (int y = 0; y < 40; ++y) {
+        nlohmann::json row = nlohmann::json::array();
+        for (int x = 0; x < Board::width; ++x) {
+            if (cells[x][y].has_value())
+                row.push_back(cells[x][y].value());
+            else
+                row.push_back(nullptr);
+        }
+        start["board"].push_back(row);
+    }
+
+    start["opponents"] = nlohmann::json::array();
+    start["opponents"][0]["board"] = board_rows(opp.board, Board::height, Board::height);
+    return start.dump();
+}
+
+static std::string play(const Game& opp, const Piece& piece) {
+    static constexpr const char* orientations[] = { "north", "east", "south", "west" };
+    static constexpr const char* spins[] = { "none", "mini", "full" };
+    nlohmann::json play;
+    play["type"] = "play";
+    play["move"]["location"]["type"] = piece_name(piece.type);
+    play["move"]["location"]["orientation"] = orientations[piece.rotation];
+    play["move"]["location"]["x"] = piece.position.x;
+    play["move"]["location"]["y"] = piece.position.y;
+    play["move"]["spin"] = spins[u8(piece.spin)];
+
+    play["opponents"] = nlohmann::json::array();
+    play["opponents"][0]["board"] = board_rows(opp.board, Board::height, Board::height);
+    play["opponents"][0]["combo"] = opp.stats.combo;
+    play["opponents"][0]["back_to_back"] = opp.stats.b2b;
+    play["opponents"][0]["meter"] = opp.garbage_meter;
+    play["opponents"][0]["queue"] = nlohmann::json::array();
+    play["opponents"][0]["queue"].push_back(piece_name(opp.current_piece.type));
+    for (PieceType type : opp.queue)
+        play["opponents"][0]["queue"].push_back(piece_name(type));
+    return play.dump();
+}
+
+static std::string new_piece(PieceType type) {
+    nlohmann::json new_piece;
+    new_piece["type"] = "new_piece";
+    new_piece["piece"] = piece_name(type);
+    return new_piece.dump();
+}
+
+static std::string suggest() {
+    nlohmann::json suggest;
+    suggest["type"] = "suggest";
+    return suggest.dump();
+}
+
+// the moves of a suggestion, read from the whole parsed document
+static void suggestion(const std::string& line, std::vector<Piece>& moves) {
+    static constexpr const char* orientations[] = { "north", "east", "south", "west" };
+    static constexpr const char* spins[] = { "none", "mini", "full" };
+    auto index_of = [](std::span<const char* const> names, const std::string& name) {
+        for (size_t i = 0; i < names.size(); i++)
+            if (name == names[i])
+                return i;
+        throw std::runtime_error("invalid " + name);
+    };
+    static constexpr const char* pieces[] = { "S", "Z", "J", "L", "T", "O", "I" };
+
+    const nlohmann::json suggestion = nlohmann::json::parse(line);
+    moves.clear();
+    for (const auto& move : suggestion["moves"]) {
+        const auto& location = move["location"];
+        moves.push_back(Piece(PieceType(index_of(pieces, location["type"].get<std::string>())),
+                              Coord{ int8_t(location["x"].get<int>()), int8_t(location["y"].get<int>()) },
+                              RotationDirection(index_of(orientations, location["orientation"].get<std::string>())),
+                              spinType(index_of(spins, move["spin"].get<std::string>()))));
+    }
+}
+
+}  // namespace reference
+
+// a suggestion of count random moves as a bot would send it
+static std::string random_suggestion(std::mt19937& rng, size_t count) {
+    static constexpr const char* orientations[] = { "north", "east", "south", "west" };
+    static constexpr const char* spins[] = { "none", "mini", "full" };
+    nlohmann::json suggestion;
+    suggestion["type"] = "suggestion";
+    suggestion["moves"] = nlohmann::json::array();
+    for (size_t i = 0; i < count; i++) {
+        nlohmann::json move;
+        move["location"]["type"] = reference::piece_name(PieceType(rng() % 7));
+        move["location"]["orientation"] = orientations[rng() % 4];
+        move["location"]["x"] = int(rng() % Board::width);
+        move["location"]["y"] = int(rng() % Board::visual_height);
+        move["spin"] = spins[rng() % 3];
+        suggestion["moves"].push_back(move);
+    }
+    return suggestion.dump();
+}
+
+// a game some way in, random cells up to a random height and random stats
+struct bench_position {
+    Game self;
+    Game opp;
+    std::vector<PieceType> queue;
+    Piece move;
+};
+
+static bench_position random_position(std::mt19937& rng) {
+    auto random_game = [&] {
+        Game game;
+        const int height = int(rng() % Board::visual_height);
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < Board::width; x++)
+                if (rng() % 4 != 0)
+                    game.board.set(x, y);
+        game.current_piece = Piece(PieceType(rng() % 7));
+        for (PieceType& type : game.queue)
+            type = PieceType(rng() % 7);
+        if (rng() % 2)
+            game.hold = Piece(PieceType(rng() % 7));
+        game.stats.combo = int(rng() % 8);
+        game.stats.b2b = int(rng() % 4);
+        game.garbage_meter = int(rng() % 12);
+        return game;
+    };
+
+    bench_position position{ random_game(), random_game(), {}, Piece(PieceType::T) };
+    position.queue.push_back(position.self.current_piece.type);
+    position.queue.insert(position.queue.end(), position.self.queue.begin(), position.self.queue.end());
+    position.move = Piece(PieceType(rng() % 7), Coord{ int8_t(rng() % Board::width), int8_t(rng() % Board::visual_height) },
+                          RotationDirection(rng() % 4), spinType(rng() % 3));
+    return position;
+}
+
+// what a turn sends one bot: a suggest, two new pieces and a play, and a start every fourth turn for the garbage
+template <typename Start, typename Play, typename NewPiece, typename Suggest>
+static double time_turns(std::span<const bench_position> positions, size_t turns, Start&& start, Play&& play, NewPiece&& new_piece, Suggest&& suggest,
+                         size_t& bytes) {
+    const auto begin = std::chrono::steady_clock::now();
+    for (size_t turn = 0; turn < turns; turn++) {
+        const bench_position& p = positions[turn % positions.size()];
+        bytes += suggest().size();
+        bytes += new_piece(p.self.queue[3]).size();
+        bytes += new_piece(p.self.queue.back()).size();
+        if (turn % 4 == 0)
+            bytes += start(p.opp, p.self.board, p.queue, p.self.hold, p.self.stats.b2b != 0, p.self.stats.combo).size();
+        else
+            bytes += play(p.opp, p.move).size();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char* argv[]) {
+    // the args should look like this: ./a.out <optional:turns> <optional:seed>
+    std::span<char*> args(argv, argc);
+    std::vector<std::string> vargs(args.begin(), args.end());
+
+    size_t turns = 100000;
+    uint32_t seed = 0;
+    try {
+        if (vargs.size() > 1)
+            turns = std::stoull(vargs[1]);
+        seed = vargs.size() > 2 ? (uint32_t)std::stoul(vargs[2]) : std::random_device()();
+    } catch (const std::exception&) {
+        std::cerr << "Usage: " << std::filesystem::path(vargs[0]).filename() << " <optional:turns> <optional:seed>" << std::endl;
+        return 1;
+    }
+
+    std::mt19937 rng(seed);
+    std::vector<bench_position> positions;
+    for (int i = 0; i < 1024; i++)
+        positions.push_back(random_position(rng));
+
+    TBPWriter writer;
+    size_t mismatches = 0;
+    for (const bench_position& p : positions) {
+        auto check = [&](std::string_view written, const std::string& expected, const char* message) {
+            if (written != expected) {
+                if (mismatches == 0)
+                    std::cerr << message << " differs:\n  writer: " << written << "\n  json:   " << expected << std::endl;
+                mismatches++;
+            }
+        };
+        check(writer.start(p.opp, p.self.board, p.queue, p.self.hold, p.self.stats.b2b != 0, p.self.stats.combo),
+              reference::start(p.opp, p.self.board, p.queue, p.self.hold, p.self.stats.b2b != 0, p.self.stats.combo), "start");
+        check(writer.start(p.opp, p.self.board, p.queue, std::nullopt, false, 0), reference::start(p.opp, p.self.board, p.queue, std::nullopt, false, 0),
+              "start without hold");
+        check(writer.play(p.opp, p.move), reference::play(p.opp, p.move), "play");
+        check(writer.new_piece(p.move.type), reference::new_piece(p.move.type), "new_piece");
+        check(writer.suggest(), reference::suggest(), "suggest");
+    }
+    std::cout << positions.size() << " positions, " << mismatches << " messages differ from the json ones" << std::endl;
+
+    size_t json_bytes = 0;
+    const double json_seconds = time_turns(
+        positions, turns, reference::start, reference::play, reference::new_piece, reference::suggest, json_bytes);
+
+    size_t writer_bytes = 0;
+    const double writer_seconds = time_turns(
+        positions, turns,
+        [&](auto&&... start_args) { return writer.start(start_args...); },
+        [&](const Game& opp, const Piece& move) { return writer.play(opp, move); },
+        [&](PieceType type) { return writer.new_piece(type); },
+        [&] { return writer.suggest(); }, writer_bytes);
+
+    auto report = [&](const char* name, double seconds, size_t bytes) {
+        std::cout << name << ": " << seconds * 1e9 / double(turns) << " ns a turn, " << double(bytes) / seconds / 1e6 << " MB/s" << std::endl;
+    };
+    report("json  ", json_seconds, json_bytes);
+    report("writer", writer_seconds, writer_bytes);
+    std::cout << "speedup: " << json_seconds / writer_seconds << "x over " << turns << " turns, seed " << seed << std::endl;
+
+    // suggestions of one move and of the dozens of ranked moves some bots send
+    for (size_t move_count : { size_t(1), size_t(32) }) {
+        std::vector<std::string> suggestions;
+        for (int i = 0; i < 256; i++)
+            suggestions.push_back(random_suggestion(rng, move_count));
+
+        std::vector<Piece> read;
+        std::vector<Piece> expected;
+        for (const std::string& line : suggestions) {
+            TBPReader::suggestion(line, read);
+            reference::suggestion(line, expected);
+            bool same = read.size() == expected.size();
+            for (size_t i = 0; same && i < read.size(); i++)
+                same = read[i].type == expected[i].type && read[i].rotation == expected[i].rotation && read[i].position.x == expected[i].position.x &&
+                       read[i].position.y == expected[i].position.y && read[i].spin == expected[i].spin;
+            if (!same) {
+                if (mismatches == 0)
+                    std::cerr << "suggestion read differently: " << line << std::endl;
+                mismatches++;
+            }
+        }
+
+        auto time_reads = [&](auto&& read_suggestion) {
+            const auto begin = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < turns; i++)
+                read_suggestion(suggestions[i % suggestions.size()], read);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        };
+        const double json_read_seconds = time_reads(reference::suggestion);
+        const double reader_seconds = time_reads([](const std::string& line, std::vector<Piece>& moves) { TBPReader::suggestion(line, moves); });
+        std::cout << "suggestions of " << move_count << " moves: json " << json_read_seconds * 1e9 / double(turns) << " ns, reader "
+                  << reader_seconds * 1e9 / double(turns) << " ns, speedup " << json_read_seconds / reader_seconds << "x" << std::endl;
+    }
+    std::cout << mismatches << " messages differ from the json ones in all" << std::endl;
+
+    return mismatches == 0 ? 0 : 1;
+}